@@ -0,0 +1,126 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "pigeon/bytes.h"
+
+// Packets per second through the package1 example's dispatcher, which copies
+// the header and then the whole package, against byte_dispatcher, which hands
+// the package over in place and copies only misaligned ones.
+
+enum class type: std::uint8_t { one, two, three };
+
+struct header             { type Type; };
+struct one:   header      { char Data[32]; };
+struct two:   header      { std::uint32_t Data; };
+struct three: header      { unsigned char Data[1024]; };  // the big one, copying it dominates
+
+struct packet 
+{ 
+  const unsigned char* Data; 
+  size_t Size; 
+
+  const unsigned char* data() const { return Data; }
+  size_t               size() const { return Size; }
+};
+
+struct copying_dispatcher
+  // as in examples/cpp20/package/package1.cpp
+{
+  pigeon::message<void(one   const&)> msgOne;
+  pigeon::message<void(two   const&)> msgTwo;
+  pigeon::message<void(three const&)> msgThree;
+
+  void dispatch(packet p)
+  {
+    header h;
+    std::memcpy(&h, p.data(), sizeof h);
+    switch (h.Type)
+    {
+      case type::one:   { one   o; std::memcpy(&o, p.data(), sizeof o); msgOne.send(o);   break; }
+      case type::two:   { two   t; std::memcpy(&t, p.data(), sizeof t); msgTwo.send(t);   break; }
+      case type::three: { three t; std::memcpy(&t, p.data(), sizeof t); msgThree.send(t); break; }
+    }
+  }
+};
+
+using zero_copy_dispatcher = pigeon::byte_dispatcher<pigeon::tag_field<type>, one, two, three>;
+
+std::vector<packet> make_packets(std::vector<unsigned char>& buffer, size_t shift)
+  // one packet of each type in turn, every packet starts shift bytes after an 8 byte boundary
+{
+  size_t const count{300};
+  size_t const stride{1088};
+  buffer.assign(count * stride + stride, 0);
+  auto base = buffer.data() + (stride - reinterpret_cast<std::uintptr_t>(buffer.data()) % stride) % stride;
+
+  std::vector<packet> packets;
+  for (size_t index = 0; index < count; ++index)
+  {
+    auto data = base + index * stride + shift;
+    switch (index % 3)
+    {
+      case 0: { one   o{}; o.Type = type::one;   std::memcpy(data, &o, sizeof o); packets.push_back(packet{data, sizeof o}); break; }
+      case 1: { two   t{}; t.Type = type::two;   t.Data = static_cast<std::uint32_t>(index); std::memcpy(data, &t, sizeof t); packets.push_back(packet{data, sizeof t}); break; }
+      case 2: { three t{}; t.Type = type::three; std::memcpy(data, &t, sizeof t); packets.push_back(packet{data, sizeof t}); break; }
+    }
+  }
+  return packets;
+}
+
+template <typename D, typename S>
+double packets_per_second(D& dispatcher, S&& subscribe, std::vector<packet> const& packets)
+{
+  pigeon::pigeon pigeon;
+  std::uint64_t checksum{0};
+  subscribe(pigeon, dispatcher, checksum);
+
+  int const rounds{20000};
+  auto start = std::chrono::steady_clock::now();
+  for (int round = 0; round < rounds; ++round)
+    for (auto& p: packets)
+      dispatcher.dispatch(p);
+  auto stop = std::chrono::steady_clock::now();
+
+  if (checksum == 0)
+    std::printf("wrong checksum!\n");
+
+  std::chrono::duration<double> elapsed = stop - start;
+  return rounds * packets.size() / elapsed.count();
+}
+
+int main()
+{
+  auto subscribeCopying = [](pigeon::pigeon& pigeon, copying_dispatcher& dispatcher, std::uint64_t& checksum)
+    {
+      pigeon.deliver(dispatcher.msgOne,   [&checksum](one   const& o) { checksum += static_cast<unsigned char>(o.Data[0]) + 1; });
+      pigeon.deliver(dispatcher.msgTwo,   [&checksum](two   const& t) { checksum += t.Data; });
+      pigeon.deliver(dispatcher.msgThree, [&checksum](three const& t) { checksum += t.Data[0] + 1; });
+    };
+
+  auto subscribeZeroCopy = [](pigeon::pigeon& pigeon, zero_copy_dispatcher& dispatcher, std::uint64_t& checksum)
+    {
+      pigeon.deliver(dispatcher.payload<one  >(), [&checksum](one   const& o) { checksum += static_cast<unsigned char>(o.Data[0]) + 1; });
+      pigeon.deliver(dispatcher.payload<two  >(), [&checksum](two   const& t) { checksum += t.Data; });
+      pigeon.deliver(dispatcher.payload<three>(), [&checksum](three const& t) { checksum += t.Data[0] + 1; });
+    };
+
+  std::vector<unsigned char> alignedBuffer, misalignedBuffer;
+  auto aligned    = make_packets(alignedBuffer, 0);
+  auto misaligned = make_packets(misalignedBuffer, 1);
+
+  std::printf("%-30s %16s\n", "dispatcher", "packets/s");
+
+  copying_dispatcher copying;
+  std::printf("%-30s %16.0f\n", "package1 memcpy", packets_per_second(copying, subscribeCopying, aligned));
+
+  zero_copy_dispatcher zeroCopy;
+  std::printf("%-30s %16.0f\n", "byte_dispatcher aligned", packets_per_second(zeroCopy, subscribeZeroCopy, aligned));
+
+  zero_copy_dispatcher misalignedZeroCopy;
+  std::printf("%-30s %16.0f\n", "byte_dispatcher misaligned", packets_per_second(misalignedZeroCopy, subscribeZeroCopy, misaligned));
+
+  return 0;
+}
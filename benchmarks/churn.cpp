@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "pigeon/pigeon.h"
+
+// Mass subscribe and unsubscribe, as in a storm of session reconnects: deliver, drop by token
+// in random order, pigeon::clear, the message going away before the pigeon and the other way
+// round, allocator_pigeon teardown and many pigeons with one contact each.
+// Only the operation itself is timed, the peak RSS covers setup and operation and includes
+// what malloc kept from the scenarios before.
+// Operations per second have to stay flat while the number of contacts grows.
+
+using clock_type = std::chrono::steady_clock;
+using message_type = pigeon::message<void(int)>;
+
+struct result
+{
+  double OpsPerSecond;
+  double PeakMegabytes;
+};
+
+void reset_peak_rss()
+  // Linux resets the high water mark, elsewhere the peak stays the one of the process
+{
+  if (auto file = std::fopen("/proc/self/clear_refs", "w"))
+  {
+    std::fputs("5", file);
+    std::fclose(file);
+  }
+}
+
+double peak_rss_megabytes()
+{
+  if (auto file = std::fopen("/proc/self/status", "r"))
+  {
+    char line[256];
+    long kilobytes{-1};
+    while (std::fgets(line, sizeof line, file))
+      if (std::strncmp(line, "VmHWM:", 6) == 0)
+        std::sscanf(line + 6, "%ld", &kilobytes);
+    std::fclose(file);
+    if (kilobytes >= 0)
+      return kilobytes / 1024.0;
+  }
+#if defined(__unix__) || defined(__APPLE__)
+  rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+  return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+  return usage.ru_maxrss / 1024.0;
+#endif
+#else
+  return 0;
+#endif
+}
+
+template <typename Setup>
+result measure(int contacts, Setup&& setup)
+  // setup prepares a scenario and returns the operation to time
+{
+  reset_peak_rss();
+  double elapsed{0};
+  {
+    auto operation = setup();
+    auto start = clock_type::now();
+    operation();
+    elapsed = std::chrono::duration<double>(clock_type::now() - start).count();
+  }
+  return result{contacts / elapsed, peak_rss_megabytes()};
+}
+
+void print(const char* scenario, int contacts, result r)
+{
+  std::printf("%-22s %10d %12.2f %12.1f\n", scenario, contacts, r.OpsPerSecond / 1e6, r.PeakMegabytes);
+}
+
+struct handler
+{
+  long* Calls;
+  void operator()(int value) { *Calls += value; }
+};
+
+template <typename P>
+std::vector<pigeon::contact_token> deliver_all(P& pigeon, message_type& message, int contacts, long& calls)
+{
+  std::vector<pigeon::contact_token> tokens;
+  tokens.reserve(contacts);
+  for (int k = 0; k < contacts; ++k)
+    tokens.push_back(pigeon.deliver(message, handler{&calls}));
+  return tokens;
+}
+
+// A scenario keeps its pigeon and message in a state that outlives setup,
+// the operation only captures what it works on.
+struct state
+{
+  std::unique_ptr<pigeon::pigeon> Pigeon{new pigeon::pigeon};
+  std::unique_ptr<message_type> Message{new message_type};
+  std::vector<pigeon::contact_token> Tokens;
+  long Calls{0};
+};
+
+result deliver(int contacts)
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      s->Tokens.reserve(contacts);
+      return [s, contacts]
+        {
+          for (int k = 0; k < contacts; ++k)
+            s->Tokens.push_back(s->Pigeon->deliver(*s->Message, handler{&s->Calls}));
+        };
+    });
+}
+
+result drop_tokens(int contacts)
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      s->Tokens = deliver_all(*s->Pigeon, *s->Message, contacts, s->Calls);
+      std::shuffle(s->Tokens.begin(), s->Tokens.end(), std::mt19937{42});
+      return [s]
+        {
+          for (auto token: s->Tokens)
+            s->Pigeon->drop(token);
+        };
+    });
+}
+
+result clear(int contacts)
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      s->Tokens = deliver_all(*s->Pigeon, *s->Message, contacts, s->Calls);
+      return [s] { s->Pigeon->clear(); };
+    });
+}
+
+result message_first(int contacts)
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      s->Tokens = deliver_all(*s->Pigeon, *s->Message, contacts, s->Calls);
+      return [s] { s->Message.reset(); };
+    });
+}
+
+result pigeon_first(int contacts)
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      s->Tokens = deliver_all(*s->Pigeon, *s->Message, contacts, s->Calls);
+      return [s] { s->Pigeon.reset(); };
+    });
+}
+
+result allocator_teardown(int contacts)
+{
+  using arena_pigeon = pigeon::allocator_pigeon<pigeon::arena_chunk_allocator<>>;
+
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      std::shared_ptr<arena_pigeon> p{new arena_pigeon};
+      s->Tokens = deliver_all(*p, *s->Message, contacts, s->Calls);
+      return [s, p]() mutable { p.reset(); };
+    });
+}
+
+result reconnect(int contacts)
+  // a pigeon per session with one contact, every session goes away
+{
+  return measure(contacts, [contacts]
+    {
+      std::shared_ptr<state> s{new state};
+      std::shared_ptr<std::vector<pigeon::pigeon>> sessions{new std::vector<pigeon::pigeon>(contacts)};
+      for (auto& session: *sessions)
+        session.deliver(*s->Message, handler{&s->Calls});
+      return [s, sessions] { sessions->clear(); };
+    });
+}
+
+int main()
+{
+  std::printf("%-22s %10s %12s %12s\n", "scenario", "contacts", "Mops/s", "peak RSS MB");
+  for (int contacts: {1000, 10000, 100000, 1000000})
+  {
+    print("deliver",            contacts, deliver(contacts));
+    print("drop(token)",        contacts, drop_tokens(contacts));
+    print("pigeon::clear",      contacts, clear(contacts));
+    print("message first",      contacts, message_first(contacts));
+    print("pigeon first",       contacts, pigeon_first(contacts));
+    print("allocator_pigeon",   contacts, allocator_teardown(contacts));
+    print("pigeon per session", contacts, reconnect(contacts));
+  }
+
+  return 0;
+}
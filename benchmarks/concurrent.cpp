@@ -0,0 +1,108 @@
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pigeon/concurrent.h"
+
+// Several threads send the same message with 8 handlers, 
+// while one more thread keeps delivering and dropping a handler.
+// concurrent_message against a message behind a std::mutex.
+
+const int Handlers = 8;
+const int Sends    = 200000;
+
+void handler(int value) 
+{ 
+  volatile int sink = value * 3; 
+  (void)sink; 
+}
+
+struct locked_message
+{
+  std::mutex                 Mutex;
+  pigeon::message<void(int)> Message;
+
+  void send(int value)
+  {
+    std::lock_guard<std::mutex> lock{Mutex};
+    Message.send(value);
+  }
+
+  pigeon::contact_token deliver(pigeon::pigeon& pigeon)
+  {
+    std::lock_guard<std::mutex> lock{Mutex};
+    return pigeon.deliver(Message, [](int value) { handler(value); });
+  }
+
+  void drop(pigeon::pigeon& pigeon, pigeon::contact_token token)
+  {
+    std::lock_guard<std::mutex> lock{Mutex};
+    pigeon.drop(token);
+  }
+};
+
+struct unlocked_message
+{
+  pigeon::concurrent_message<void(int)> Message;
+
+  void send(int value) { Message.send(value); }
+
+  pigeon::contact_token deliver(pigeon::pigeon& pigeon) 
+  { return pigeon.deliver(Message, [](int value) { handler(value); }); }
+
+  void drop(pigeon::pigeon& pigeon, pigeon::contact_token token) 
+  { pigeon.drop(token); }
+};
+
+template <typename M>
+double million_sends_per_second(int threads)
+{
+  M message;
+  pigeon::pigeon pigeon;
+  for (int count = 0; count < Handlers; ++count)
+    message.deliver(pigeon);
+
+  std::atomic<bool> done{false};
+  std::thread churner{[&message, &done] 
+    {
+      pigeon::pigeon pigeon;
+      while (not done)
+      {
+        message.drop(pigeon, message.deliver(pigeon));
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }};
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> senders;
+  for (int thread = 0; thread < threads; ++thread)
+    senders.emplace_back([&message] 
+      { 
+        for (int count = 0; count < Sends; ++count) 
+          message.send(count); 
+      });
+
+  for (auto& sender: senders)
+    sender.join();
+
+  auto stop = std::chrono::steady_clock::now();
+  done = true;
+  churner.join();
+
+  std::chrono::duration<double, std::micro> elapsed = stop - start;
+  return threads * Sends / elapsed.count();
+}
+
+int main()
+{
+  auto cores = static_cast<int>(std::thread::hardware_concurrency());
+  std::printf("%8s %24s %24s\n", "threads", "mutex million sends/s", "concurrent million sends/s");
+  for (int threads = 1; threads <= (cores > 1 ? 2 * cores : 2); threads *= 2)
+    std::printf("%8d %24.2f %24.2f\n", threads,
+      million_sends_per_second<locked_message  >(threads),
+      million_sends_per_second<unlocked_message>(threads));
+
+  return 0;
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "pigeon/concurrent.h"
+#include "pigeon/mailbox.h"
+
+// Throughput: several threads send as fast as they can, the receiver pumps in batches.
+// Latency: one thread sends a time stamp now and then, the receiver sleeps in wait.
+
+using clock_type = std::chrono::steady_clock;
+
+double million_mails_per_second(int threads, size_t batch)
+{
+  const int Sends = 500000;
+
+  pigeon::concurrent_message<void(int)> message;
+  pigeon::mailbox_pigeon pigeon{1024};
+
+  long count{0};
+  pigeon.deliver(message, [&count](int) { ++count; });
+
+  auto start = clock_type::now();
+  std::vector<std::thread> senders;
+  for (int thread = 0; thread < threads; ++thread)
+    senders.emplace_back([&message] 
+      { 
+        for (int value = 0; value < Sends; ++value) 
+          message.send(value); 
+      });
+
+  while (count < long{threads} * Sends)
+    if (pigeon.wait(std::chrono::milliseconds(100)))
+      pigeon.pump(batch);
+
+  auto stop = clock_type::now();
+  for (auto& sender: senders)
+    sender.join();
+
+  std::chrono::duration<double, std::micro> elapsed = stop - start;
+  return count / elapsed.count();
+}
+
+void latency()
+{
+  const int Sends = 2000;
+
+  pigeon::concurrent_message<void(clock_type::time_point)> message;
+  pigeon::mailbox_pigeon pigeon;
+
+  std::vector<double> latencies;
+  latencies.reserve(Sends);
+  pigeon.deliver(message, [&latencies](clock_type::time_point sent) 
+    { 
+      std::chrono::duration<double, std::micro> latency = clock_type::now() - sent;
+      latencies.push_back(latency.count()); 
+    });
+
+  std::thread sender{[&message] 
+    {
+      for (int count = 0; count < Sends; ++count)
+      {
+        message.send(clock_type::now());
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }};
+
+  while (latencies.size() < Sends)
+    if (pigeon.wait(std::chrono::milliseconds(100)))
+      pigeon.pump();
+
+  sender.join();
+
+  std::sort(latencies.begin(), latencies.end());
+  std::printf("latency with wakeup: p50 %.1f us, p99 %.1f us, max %.1f us\n", 
+    latencies[Sends / 2], latencies[Sends * 99 / 100], latencies.back());
+}
+
+int main()
+{
+  auto cores = static_cast<int>(std::thread::hardware_concurrency());
+  std::printf("%8s %8s %20s\n", "threads", "batch", "million mails/s");
+  for (int threads = 1; threads <= (cores > 1 ? cores : 2); threads *= 2)
+    for (size_t batch: {1, 64})
+      std::printf("%8d %8zu %20.2f\n", threads, batch, million_mails_per_second(threads, batch));
+
+  latency();
+  return 0;
+}
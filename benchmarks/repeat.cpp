@@ -0,0 +1,63 @@
+#include <chrono>
+#include <cstdio>
+
+#include "pigeon/pigeon.h"
+
+// A value_state change chain: every handler changes the value once, so every
+// handler triggers an iteration_state::repeat of all the other handlers.
+// The time per handler has to stay flat while the number of handlers grows.
+
+template <typename S>
+double nanoseconds_per_handler(int handlers)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(int&, pigeon::value_state&), pigeon::global_access, S> message;
+
+  // handler k is the (handlers - 1 - k)th one being delivered
+  for (int k = 0; k < handlers; ++k)
+    pigeon.deliver(message, [k, handlers](int& value, pigeon::value_state& state)
+      {
+        if (value == handlers - 1 - k)
+        {
+          ++value;
+          state = pigeon::value_state::changed;
+        }
+      });
+
+  int const sends = 1 + 4000000 / handlers;
+  int checksum{0};
+
+  auto start = std::chrono::steady_clock::now();
+  for (int count = 0; count < sends; ++count)
+  {
+    int value{0};
+    pigeon::value_state state{pigeon::value_state::original};
+    message.response(value, state, [&state]
+      {
+        if (state != pigeon::value_state::changed)
+          return pigeon::iteration_state::progress;
+
+        state = pigeon::value_state::original;
+        return pigeon::iteration_state::repeat;
+      });
+    checksum += value;
+  }
+  auto stop = std::chrono::steady_clock::now();
+
+  if (checksum != sends * handlers)
+    std::printf("wrong checksum!\n");
+
+  std::chrono::duration<double, std::nano> elapsed = stop - start;
+  return elapsed.count() / sends / handlers;
+}
+
+int main()
+{
+  std::printf("%10s %18s %18s\n", "handlers", "list ns/handler", "array ns/handler");
+  for (int handlers = 16; handlers <= 65536; handlers *= 4)
+    std::printf("%10d %18.2f %18.2f\n", handlers,
+      nanoseconds_per_handler<pigeon::list_storage >(handlers),
+      nanoseconds_per_handler<pigeon::array_storage>(handlers));
+
+  return 0;
+}
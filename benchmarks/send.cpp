@@ -0,0 +1,162 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "pigeon/pigeon.h"
+
+// Throughput and latency of one send over 1 to 100k subscribers,
+// for three handler signatures, with the default allocation and with an arena,
+// against a std::vector<std::function> walked by hand.
+// Throughput is handler calls per second, latency is the time of a whole send.
+
+using clock_type = std::chrono::steady_clock;
+
+struct result
+{
+  double CallsPerSecond;
+  double P50;  // ns per send
+  double P99;
+};
+
+template <typename F>
+result measure(int subscribers, F&& send)
+{
+  // about the same number of handler calls for every subscriber count
+  int const sends = std::max(100, 4000000 / subscribers);
+
+  for (int warmup = 0; warmup < std::min(sends, 10); ++warmup)
+    send();
+
+  std::vector<double> samples;
+  samples.reserve(sends);
+  auto start = clock_type::now();
+  for (int count = 0; count < sends; ++count)
+  {
+    auto begin = clock_type::now();
+    send();
+    samples.push_back(std::chrono::duration<double, std::nano>(clock_type::now() - begin).count());
+  }
+  std::chrono::duration<double> elapsed = clock_type::now() - start;
+
+  std::sort(samples.begin(), samples.end());
+  return result{double(sends) * subscribers / elapsed.count(), 
+                samples[samples.size() / 2], samples[samples.size() * 99 / 100]};
+}
+
+void print(const char* signature, const char* variant, int subscribers, result r)
+{
+  std::printf("%-12s %-10s %10d %14.1f %14.0f %14.0f\n", signature, variant, subscribers, r.CallsPerSecond / 1e6, r.P50, r.P99);
+}
+
+// arena_heap_allocator has a fixed size, big enough for 100k inboxes
+using arena_pigeon = pigeon::allocator_pigeon<pigeon::arena_heap_allocator<32 * 1024 * 1024>>;
+
+template <typename P>
+result send_void(int subscribers)
+{
+  std::unique_ptr<P> pigeon{new P};
+  pigeon::message<void()> message;
+
+  long calls{0};
+  for (int k = 0; k < subscribers; ++k)
+    pigeon->deliver(message, [&calls] { ++calls; });
+
+  return measure(subscribers, [&message] { message.send(); });
+}
+
+template <typename P>
+result send_string(int subscribers)
+{
+  std::unique_ptr<P> pigeon{new P};
+  pigeon::message<void(std::string)> message;
+
+  size_t length{0};
+  for (int k = 0; k < subscribers; ++k)
+    pigeon->deliver(message, [&length](std::string text) { length += text.size(); });
+
+  std::string const text(40, 'x');  // beyond the small string buffer
+  return measure(subscribers, [&message, &text] { message.send(text); });
+}
+
+template <typename P>
+result send_repeat(int subscribers)
+  // the middle handler changes the value once per send, one repeat of the others
+{
+  std::unique_ptr<P> pigeon{new P};
+  pigeon::message<void(int&, pigeon::value_state&)> message;
+
+  for (int k = 0; k < subscribers; ++k)
+    pigeon->deliver(message, [k, subscribers](int& value, pigeon::value_state& state)
+      {
+        if (k == subscribers / 2 and value == 0)
+        {
+          value = 1;
+          state = pigeon::value_state::changed;
+        }
+      });
+
+  return measure(subscribers, [&message] 
+    { 
+      int value{0};
+      pigeon::value_state state{pigeon::value_state::original};
+      message.response(value, state, [&state]
+        {
+          if (state != pigeon::value_state::changed)
+            return pigeon::iteration_state::progress;
+
+          state = pigeon::value_state::original;
+          return pigeon::iteration_state::repeat;
+        });
+    });
+}
+
+result baseline_void(int subscribers)
+{
+  long calls{0};
+  std::vector<std::function<void()>> handlers;
+  for (int k = 0; k < subscribers; ++k)
+    handlers.emplace_back([&calls] { ++calls; });
+
+  return measure(subscribers, [&handlers] 
+    { 
+      for (auto& handler: handlers) 
+        handler(); 
+    });
+}
+
+result baseline_string(int subscribers)
+{
+  size_t length{0};
+  std::vector<std::function<void(std::string)>> handlers;
+  for (int k = 0; k < subscribers; ++k)
+    handlers.emplace_back([&length](std::string text) { length += text.size(); });
+
+  std::string const text(40, 'x');
+  return measure(subscribers, [&handlers, &text] 
+    { 
+      for (auto& handler: handlers) 
+        handler(text); 
+    });
+}
+
+int main()
+{
+  std::printf("%-12s %-10s %10s %14s %14s %14s\n", "signature", "variant", "subscribers", "Mcalls/s", "p50 ns/send", "p99 ns/send");
+  for (int subscribers: {1, 10, 100, 1000, 10000, 100000})
+  {
+    print("void()",      "pigeon",   subscribers, send_void<pigeon::pigeon>(subscribers));
+    print("void()",      "arena",    subscribers, send_void<arena_pigeon>(subscribers));
+    print("void()",      "function", subscribers, baseline_void(subscribers));
+    print("void(string)", "pigeon",   subscribers, send_string<pigeon::pigeon>(subscribers));
+    print("void(string)", "arena",    subscribers, send_string<arena_pigeon>(subscribers));
+    print("void(string)", "function", subscribers, baseline_string(subscribers));
+    print("value_state", "pigeon",   subscribers, send_repeat<pigeon::pigeon>(subscribers));
+    print("value_state", "arena",    subscribers, send_repeat<arena_pigeon>(subscribers));
+  }
+
+  return 0;
+}
@@ -1,11 +1,10 @@
-#include "pigeon/pigeon.h"
+#include "pigeon/bytes.h"
 
 #include <cstddef>
 #include <cstdint>
 #include <array>
 #include <span>
 #include <type_traits>
-#include <cstring>
 #include <iostream>
 
 struct Generator 
@@ -14,18 +13,15 @@ struct Generator
   void generate();
 };
 
-class PackageOne;
-class PackageTwo;
-class PackageThree;
+enum class ePackageType:std::underlying_type_t<std::byte>{One, Two, Three, Four};
 
-struct Dispatcher: pigeon::receiver<Dispatcher>
-{
-  pigeon::message<void(PackageOne   const&)> msgOne;
-  pigeon::message<void(PackageTwo   const&)> msgTwo;
-  pigeon::message<void(PackageThree const&)> msgThree;
+struct Package               { ePackageType Type; };
+struct PackageOne:   Package { char Data[32];};
+struct PackageTwo:   Package { std::uint32_t Data;};
+struct PackageThree: Package { std::array<std::byte,5> Data; };
 
-  void onNewPackage(std::span<std::byte const>); 
-};
+// The package type picks the message, the packages are not copied
+using Dispatcher = pigeon::byte_dispatcher<pigeon::tag_field<ePackageType>, PackageOne, PackageTwo, PackageThree>;
 
 struct PackagePrinter: pigeon::receiver<PackagePrinter> 
 {
@@ -39,92 +35,67 @@ int main()
   Dispatcher dispatcher;
   Generator generator;
 
-  dispatcher.deliver(generator.msgNewPackage, &Dispatcher::onNewPackage);
+  pigeon::pigeon stage;
+  stage.deliver(generator.msgNewPackage, [&dispatcher](std::span<const std::byte> package) { dispatcher.dispatch(package); });
 
   PackagePrinter printer;
-  printer.deliver(dispatcher.msgOne  , &PackagePrinter::onMessageOne);
-  printer.deliver(dispatcher.msgTwo  , &PackagePrinter::onMessageTwo);
-  printer.deliver(dispatcher.msgThree, &PackagePrinter::onMessageThree);
+  printer.deliver(dispatcher.payload<PackageOne  >(), &PackagePrinter::onMessageOne);
+  printer.deliver(dispatcher.payload<PackageTwo  >(), &PackagePrinter::onMessageTwo);
+  printer.deliver(dispatcher.payload<PackageThree>(), &PackagePrinter::onMessageThree);
 
-  for (auto packageCount = 0; packageCount < 100; ++packageCount)
+  // Statistics take the whole burst at once
+  pigeon::pigeon statistics;
+  std::size_t packages{0};
+  statistics.deliver(generator.msgNewPackage, pigeon::batch([&packages](auto burst) { packages += burst.size(); }));
+
+  for (auto burstCount = 0; burstCount < 25; ++burstCount)
     generator.generate();
 
+  std::cout << packages << " packages received\n";
+
   return 0;
 }
 
-enum class ePackageType:std::underlying_type_t<std::byte>{One, Two, Three, Four};
-
-struct Package               { ePackageType Type; };
-struct PackageOne:   Package { char Data[32];};
-struct PackageTwo:   Package { std::uint32_t Data;};
-struct PackageThree: Package { std::array<std::byte,5> Data; };
-
 void Generator::generate()
 {
   static PackageOne one     { ePackageType::One  , "Data for PackageOne" };
-  static PackageTwo two     { ePackageType::Two  , 42 };
+  static std::array<PackageTwo, 4> twos{};
   static PackageThree three { ePackageType::Three, {} };
 
   // pseudorandom
   static unsigned char count{0};
-  count = (count == 0) ? 1 : count * (1 + count); 
-  switch(count % 3)
-  {
-    case 0:
-    {
-      msgNewPackage.send(std::as_bytes(std::span{std::addressof(one), 1}));
-      break;
-    }
-    case 1:
-    {
-      msgNewPackage.send(std::as_bytes(std::span{std::addressof(two), 1}));
-      ++two.Data;
-      break;
-    }
-    case 2:
-    {
-      msgNewPackage.send(std::as_bytes(std::span{std::addressof(three), 1}));
-      break;
-    }
-    default:
-      throw "error";
-  }
-}
+  static std::uint32_t twoData{42};
 
-void Dispatcher::onNewPackage(std::span<const std::byte> s)
-{
-  Package package;
-  std::memcpy(&package, s.data(), sizeof (Package));
-
-  switch (package.Type)
+  // A burst of packages is sent at once, the senders are walked once per burst
+  std::array<std::span<const std::byte>, 4> burst;
+  for (std::size_t index = 0; index < burst.size(); ++index)
   {
-    case ePackageType::One:
-    {
-      PackageOne one;
-      std::memcpy(&one, s.data(), sizeof (PackageOne));
-      msgOne.send(one);
-      break;
-    }
-
-    case ePackageType::Two:
+    count = (count == 0) ? 1 : count * (1 + count); 
+    switch(count % 3)
     {
-      PackageTwo two;
-      std::memcpy(&two, s.data(), sizeof (PackageTwo));
-      msgTwo.send(two);
-      break;
-    }
-
-    case ePackageType::Three:
-    {
-      PackageThree three;
-      std::memcpy(&three, s.data(), sizeof (PackageThree));
-      msgThree.send(three);
-      break;
+      case 0:
+      {
+        burst[index] = std::as_bytes(std::span{std::addressof(one), 1});
+        break;
+      }
+      case 1:
+      {
+        // Each package of the burst needs its own PackageTwo, they are sent together
+        twos[index] = PackageTwo{ePackageType::Two, twoData++};
+        burst[index] = std::as_bytes(std::span{std::addressof(twos[index]), 1});
+        break;
+      }
+      case 2:
+      {
+        burst[index] = std::as_bytes(std::span{std::addressof(three), 1});
+        break;
+      }
+      default:
+        throw "error";
     }
+  }
 
-    default:
-      throw "error";
-  } 
+  msgNewPackage.send_batch(burst);
 }
 
 void PackagePrinter::onMessageOne(PackageOne const& package)
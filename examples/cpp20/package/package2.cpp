@@ -1,4 +1,4 @@
-#include "pigeon/pigeon.h"
+#include "pigeon/variant.h"
 
 #include <cstddef>
 #include <cstdint>
@@ -13,41 +13,32 @@ class PackageOne;
 class PackageTwo;
 class PackageThree;
 
-using Package = std::variant<PackageOne, PackageTwo, PackageThree>;
+using Package = std::variant<PackageOne, PackageTwo>;
 
 struct Generator 
 {
-  pigeon::message<pigeon::value_state(Package&&, pigeon::value_state&)> msgNewPackage;
+  // each package only reaches the subscribers of its alternative
+  pigeon::variant_message<Package> msgNewPackage;
+  // big packages are moved, the first subscriber taking the data marks it moved_from
+  pigeon::message<pigeon::value_state(PackageThree&&, pigeon::value_state&)> msgBigPackage;
   void generate();
 };
 
-struct Dispatcher: pigeon::receiver<Dispatcher>
-{
-  pigeon::message<void(PackageOne const&)> msgOne;
-  pigeon::message<void(PackageTwo const&)> msgTwo;
-  pigeon::message<void(PackageThree&&, pigeon::value_state&)> msgThree;
-
-  pigeon::value_state onNewPackage(Package&&, pigeon::value_state&); 
-};
-
 struct PackagePrinter: pigeon::receiver<PackagePrinter> 
 {
   void onMessageOne  (PackageOne   const&);
   void onMessageTwo  (PackageTwo   const&);
-  void onMessageThree(PackageThree&&, pigeon::value_state&);
+  pigeon::value_state onMessageThree(PackageThree&&, pigeon::value_state&);
 };
 
 int main()
 {
-  Dispatcher dispatcher;
   Generator generator;
 
-  dispatcher.deliver(generator.msgNewPackage, &Dispatcher::onNewPackage);
-
   PackagePrinter printer;
-  printer.deliver(dispatcher.msgOne  , &PackagePrinter::onMessageOne);
-  printer.deliver(dispatcher.msgTwo  , &PackagePrinter::onMessageTwo);
-  printer.deliver(dispatcher.msgThree, &PackagePrinter::onMessageThree);
+  printer.deliver(generator.msgNewPackage.alternative<PackageOne  >(), &PackagePrinter::onMessageOne);
+  printer.deliver(generator.msgNewPackage.alternative<PackageTwo  >(), &PackagePrinter::onMessageTwo);
+  printer.deliver(generator.msgBigPackage, &PackagePrinter::onMessageThree);
 
   for (auto packageCount = 0; packageCount < 100; ++packageCount)
     generator.generate();
@@ -64,27 +55,23 @@ void Generator::generate()
   // pseudorandom
   static unsigned char count{0};
   count = (count == 0) ? 1 : count * (1 + count); 
+
   switch(count % 3)
   {
     case 0:
-    {
-      Package package{PackageOne{"Data for PackageOne"}};
-      pigeon::value_state state{pigeon::value_state::original};
-      msgNewPackage.send(std::move(package), state);
+      // nobody listens, no need to build a package
+      if (msgNewPackage.has_subscribers())
+        msgNewPackage.send(Package{PackageOne{"Data for PackageOne"}});
       break;
-    }
     case 1:
-    {
-      Package package{PackageTwo{count}};
-      pigeon::value_state state{pigeon::value_state::original};
-      msgNewPackage.send(std::move(package), state);
+      if (msgNewPackage.has_subscribers())
+        msgNewPackage.send(Package{PackageTwo{count}});
       break;
-    }
     case 2:
     {
-      Package package{PackageThree{std::vector<std::byte>(5000)}};
+      PackageThree package{std::vector<std::byte>(5000)};
       pigeon::value_state state{pigeon::value_state::original};
-      msgNewPackage.response(std::move(package), state, [](pigeon::value_state state)
+      msgBigPackage.response(std::move(package), state, [](pigeon::value_state state)
         {
           if (state == pigeon::value_state::original)
             return pigeon::iteration_state::progress;
@@ -99,31 +86,6 @@ void Generator::generate()
   }
 }
 
-pigeon::value_state Dispatcher::onNewPackage(Package&& package, pigeon::value_state& state)
-{
-  if (state == pigeon::value_state::original)
-  {
-    std::visit([this](auto&& arg)
-    {
-      using T = std::decay_t<decltype(arg)>;
-      if constexpr (std::is_same_v<T, PackageOne>)
-        msgOne.send(arg);
-      else if constexpr (std::is_same_v<T, PackageTwo>)
-        msgTwo.send(arg);
-      else if constexpr (std::is_same_v<T, PackageThree>)
-      {
-        pigeon::value_state state{pigeon::value_state::original};
-        msgThree.send(std::move(arg), state);
-      }
-      else
-          static_assert(false, "non-exhaustive visitor!");
-    }, std::move(package));
-
-    state = pigeon::value_state::moved_from;
-  }
-  return state;
-}
-
 void PackagePrinter::onMessageOne(PackageOne const& package)
 {
   std::cout << "PackageOne received: " << package.Data << "\n";
@@ -134,12 +96,13 @@ void PackagePrinter::onMessageTwo(PackageTwo const& package)
   std::cout << "PackageTwo received: " << package.Data << "\n";
 }
 
-void PackagePrinter::onMessageThree(PackageThree&& package, pigeon::value_state& state)
+pigeon::value_state PackagePrinter::onMessageThree(PackageThree&& package, pigeon::value_state& state)
 {
   if (state == pigeon::value_state::original)
   {
     auto grabData{std::move(package.Data)};
-    std::cout << "PackageThree received\n";
+    std::cout << "PackageThree received: " << grabData.size() << " bytes\n";
     state = pigeon::value_state::moved_from;
   }
+  return state;
 }
@@ -0,0 +1,331 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/*
+bus.h:
+bus holds one message per topic name, created on first use.
+Topic levels are separated by '/', subscriptions may use the wildcards
+'+' for exactly one level and '#' as last level for any number of levels.
+Every interned topic caches the messages of all patterns matching it,
+publishing only sends to those. Publishing by name interns nothing,
+a name that is not interned is matched against the patterns each time.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pigeon 
+{
+  namespace detail
+  {
+    constexpr std::uint64_t topic_hash(const char* name, size_t size, std::uint64_t hash = 14695981039346656037ull)
+      // FNV-1a, evaluated at compile time for string literals
+    { 
+      return size == 0 ? hash 
+        : topic_hash(name + 1, size - 1, (hash ^ static_cast<unsigned char>(*name)) * 1099511628211ull); 
+    }
+
+    inline std::uint64_t runtime_topic_hash(const char* name, size_t size)
+    {
+      std::uint64_t hash{14695981039346656037ull};
+      for (size_t index = 0; index < size; ++index)
+        hash = (hash ^ static_cast<unsigned char>(name[index])) * 1099511628211ull;
+      return hash;
+    }
+
+    constexpr size_t topic_length(const char* name, size_t capacity, size_t size = 0)
+    { return size == capacity or name[size] == '\0' ? size : topic_length(name, capacity, size + 1); }
+
+    struct topic_hasher
+      // topics are hashed already
+    {
+      size_t operator()(std::uint64_t hash) const { return static_cast<size_t>(hash ^ (hash >> 32)); }
+    };
+  }
+
+  class topic
+    // A topic name or pattern with its hash, the name is not copied
+  {
+    public:
+      template <size_t N>
+      constexpr topic(const char (&name)[N])
+        : Name{name}, Size{detail::topic_length(name, N)}, Hash{detail::topic_hash(name, detail::topic_length(name, N))} { }
+
+      topic(const char* name, size_t size):Name{name}, Size{size}, Hash{detail::runtime_topic_hash(name, size)} { }
+      topic(const std::string& name):topic(name.data(), name.size()) { }
+
+      constexpr const char*   data() const { return Name; }
+      constexpr size_t        size() const { return Size; }
+      constexpr std::uint64_t hash() const { return Hash; }
+
+    private:
+      const char*   Name;
+      size_t        Size;
+      std::uint64_t Hash;
+  };
+
+  class topic_id
+    // An interned topic of one bus, publishing to it needs no lookup
+  {
+    public:
+      topic_id() = default;
+
+      std::uint32_t value() const { return Value; }
+      bool operator==(topic_id other) const { return Value == other.Value; }
+      bool operator!=(topic_id other) const { return Value != other.Value; }
+
+    private:
+      template <typename, typename> friend class bus;
+      explicit topic_id(std::uint32_t value):Value{value} { }
+
+      std::uint32_t Value{~0u};
+  };
+
+  template <typename = void(), typename = list_storage> class bus;
+
+  template <typename R, typename ...Args, typename S>
+  class bus<R(Args...), S>
+  {
+    public:
+      using message_type = message<R(Args...), global_access, S>;
+
+      bus() = default;
+      bus(bus const&) = delete;
+      bus& operator=(bus const&) = delete;
+
+      message_type& at(topic pattern)
+        // The message of a topic or pattern, deliver to it to subscribe.
+        // Throws std::invalid_argument if '#' is not the last level.
+      {
+        auto node = &Root;
+        for_each_level(pattern, [&node, &pattern](const char* begin, const char* end)
+          {
+            std::unique_ptr<trie>* child;
+            if (is_level(begin, end, '+'))
+              child = &node->One;
+            else if (is_level(begin, end, '#'))
+            {
+              if (end != pattern.data() + pattern.size())
+                throw std::invalid_argument("pigeon::bus: '#' must be the last level of a pattern");
+              child = &node->Rest;
+            }
+            else
+              child = &node->Children[std::string(begin, end)];
+
+            if (not *child)
+              child->reset(new trie);
+            node = child->get();
+          });
+
+        if (not node->Message)
+        {
+          node->Message.reset(new message_type);
+          ++Patterns;  // all cached matches are outdated
+        }
+        return *node->Message;
+      }
+
+      template <typename P, typename H>
+      contact_token subscribe(P& pigeon, topic pattern, H&& handler)
+      { return pigeon.deliver(at(pattern), std::forward<H>(handler)); }
+
+      topic_id intern(topic name)
+        // Throws std::invalid_argument for names with wildcards
+      {
+        auto known = find(name);
+        if (known != topic_id{})
+          return known;
+
+        ensureNoWildcards(name);
+
+        auto id = static_cast<std::uint32_t>(Channels.size());
+        Channels.emplace_back(new channel{std::string(name.data(), name.size())});
+        Index.emplace(name.hash(), id);
+        return topic_id{id};
+      }
+
+      void publish(topic_id id, Args ...args)
+        // Sends to the messages of all matching patterns, one after the other
+      {
+        auto& channel = *Channels.at(id.value());
+        if (channel.Generation != Patterns and not channel.Sending)
+          match(channel);
+
+        channel.Sending = true;
+        struct reset { bool& Sending; ~reset() { Sending = false; } } guard{channel.Sending};
+        auto& messages = channel.Messages;
+        for (size_t index = 0; index < messages.size(); ++index)
+          messages[index]->send(detail::hand_over<Args>::of(args, index + 1 == messages.size())...);
+      }
+
+      void publish(topic name, Args ...args) 
+        // Does not intern the name, without a matching pattern nothing happens
+      {
+        auto id = find(name);
+        if (id != topic_id{})
+          return publish(id, detail::pass<Args>(args)...);
+
+        ensureNoWildcards(name);
+
+        std::vector<message_type*> messages;
+        match(Root, name.data(), name.data() + name.size(), messages);
+        for (size_t index = 0; index < messages.size(); ++index)
+          messages[index]->send(detail::hand_over<Args>::of(args, index + 1 == messages.size())...);
+      }
+
+      bool has_subscribers(topic_id id)
+      {
+        auto& channel = *Channels.at(id.value());
+        if (channel.Generation != Patterns and not channel.Sending)
+          match(channel);
+
+        return std::any_of(channel.Messages.begin(), channel.Messages.end(), 
+          [](message_type* message) { return message->has_subscribers(); });
+      }
+
+      size_t topics() const { return Channels.size(); }
+
+      void clear()
+        // Drops all subscriptions, interned topics stay valid
+      { clear(Root); }
+
+    private:
+      struct trie
+      {
+        std::unordered_map<std::string, std::unique_ptr<trie>> Children;
+        std::unique_ptr<trie>         One;   // '+'
+        std::unique_ptr<trie>         Rest;  // '#'
+        std::unique_ptr<message_type> Message;
+      };
+
+      struct channel
+      {
+        explicit channel(std::string name):Name{std::move(name)} { }
+
+        std::string                Name;
+        std::vector<message_type*> Messages;   // of the matching patterns
+        size_t                     Generation{0};
+        bool                       Sending{false};
+      };
+
+      static bool is_level(const char* begin, const char* end, char wildcard)
+      { return end - begin == 1 and *begin == wildcard; }
+
+      static void ensureNoWildcards(topic name)
+      {
+        for_each_level(name, [](const char* begin, const char* end)
+          {
+            if (is_level(begin, end, '+') or is_level(begin, end, '#'))
+              throw std::invalid_argument("pigeon::bus: wildcards are for subscriptions only");
+          });
+      }
+
+      topic_id find(topic name) const
+        // The interned topic of name, topic_id{} if there is none
+      {
+        auto range = Index.equal_range(name.hash());
+        for (auto it = range.first; it != range.second; ++it)
+        {
+          auto& known = Channels[it->second]->Name;
+          if (known.size() == name.size() and std::equal(known.begin(), known.end(), name.data()))
+            return topic_id{it->second};
+        }
+        return topic_id{};
+      }
+
+      template <typename F>
+      static void for_each_level(topic name, F&& f)
+      {
+        auto begin = name.data();
+        auto end   = begin + name.size();
+        while (true)
+        {
+          auto level = std::find(begin, end, '/');
+          f(begin, level);
+          if (level == end)
+            break;
+          begin = level + 1;
+        }
+      }
+
+      void match(channel& channel)
+      {
+        channel.Messages.clear();
+        auto begin = channel.Name.data();
+        match(Root, begin, begin + channel.Name.size(), channel.Messages);
+        channel.Generation = Patterns;
+      }
+
+      static void match(trie& node, const char* level, const char* end, std::vector<message_type*>& matches)
+        // level is nullptr after the last level
+      {
+        if (not level)
+        {
+          if (node.Message)
+            matches.push_back(node.Message.get());
+        }
+        else
+        {
+          auto stop = std::find(level, end, '/');
+          auto next = stop == end ? nullptr : stop + 1;
+
+          auto child = node.Children.find(std::string(level, stop));
+          if (child != node.Children.end())
+            match(*child->second, next, end, matches);
+          if (node.One)
+            match(*node.One, next, end, matches);
+        }
+
+        // '#' also matches its parent level
+        if (node.Rest and node.Rest->Message)
+          matches.push_back(node.Rest->Message.get());
+      }
+
+      static void clear(trie& node)
+      {
+        if (node.Message)
+          node.Message->clear();
+        for (auto& child: node.Children)
+          clear(*child.second);
+        if (node.One)
+          clear(*node.One);
+        if (node.Rest)
+          clear(*node.Rest);
+      }
+
+      trie                                                                     Root;
+      size_t                                                                   Patterns{0};
+      std::vector<std::unique_ptr<channel>>                                    Channels;
+      std::unordered_multimap<std::uint64_t, std::uint32_t, detail::topic_hasher> Index;
+  };
+}
@@ -0,0 +1,164 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/*
+bytes.h:
+byte_dispatcher turns raw packets into typed messages without copying them.
+A tag read from a header field picks the payload type, the tag value is the index
+into the list of payload types. Each payload type has its own message, 
+its subscribers get the packet in place, only a misaligned packet is copied first.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <cstring>
+#include <tuple>
+
+namespace pigeon 
+{
+  template <typename T, size_t Offset = 0>
+  struct tag_field
+    // The header field holding the tag of a packet
+  {
+    static_assert(std::is_integral<T>::value or std::is_enum<T>::value, "a tag is an integer or an enum");
+
+    using type = T;
+    static constexpr size_t offset = Offset;
+  };
+
+  namespace detail
+  {
+    template <typename T, typename ...Ts> struct type_index;
+    template <typename T, typename ...Ts> struct type_index<T, T, Ts...>: std::integral_constant<size_t, 0> { };
+    template <typename T, typename U, typename ...Ts> struct type_index<T, U, Ts...>
+      : std::integral_constant<size_t, 1 + type_index<T, Ts...>::value> { };
+
+    template <bool ...> struct all_of: std::true_type { };
+    template <bool B, bool ...Bs> struct all_of<B, Bs...>: std::integral_constant<bool, B and all_of<Bs...>::value> { };
+
+    template <typename T>
+    typename std::enable_if<std::is_enum<T>::value, size_t>::type tag_index(T tag)
+    { return static_cast<size_t>(static_cast<typename std::underlying_type<T>::type>(tag)); }
+
+    template <typename T>
+    typename std::enable_if<not std::is_enum<T>::value, size_t>::type tag_index(T tag)
+    { return static_cast<size_t>(tag); }
+  }
+
+  template <typename Tag, typename ...Ts>
+  class byte_dispatcher
+    // The payload types are trivially copyable and each one covers a whole packet, header included
+  {
+    static_assert(sizeof...(Ts) > 0, "byte_dispatcher needs payload types");
+    static_assert(detail::all_of<std::is_trivially_copyable<Ts>::value...>::value, 
+      "payload types are read from raw bytes, they must be trivially copyable");
+    static_assert(detail::all_of<(Tag::offset + sizeof(typename Tag::type) <= sizeof(Ts))...>::value, 
+      "every payload type must contain the tag field");
+
+    public:
+      template <typename T>
+      using payload_message = message<void(T const&), byte_dispatcher>;
+
+      template <typename T>
+      payload_message<T>& payload()
+        // The message for one payload type, deliver to it to subscribe
+      { return std::get<detail::type_index<T, Ts...>::value>(Messages); }
+
+      bool dispatch(const void* data, size_t size)
+        // false if the packet was rejected: too short or an unknown tag
+      {
+        typename Tag::type tag;
+        if (size < Tag::offset + sizeof tag)
+          return reject();
+
+        std::memcpy(&tag, static_cast<const unsigned char*>(data) + Tag::offset, sizeof tag);
+        auto index = detail::tag_index(tag);
+        if (index >= sizeof...(Ts))
+          return reject();
+
+        return deliver<Ts...>(index, data, size);
+      }
+
+      template <typename B>
+      bool dispatch(B const& bytes)
+        // any contiguous byte range with data() and size(), like std::span<const std::byte>
+      { return dispatch(bytes.data(), bytes.size() * sizeof *bytes.data()); }
+
+      size_t dispatched() const { return Dispatched; }
+      size_t copied    () const { return Copied;     }  // misaligned packets
+      size_t rejected  () const { return Rejected;   }
+
+      size_t size() const
+        // subscribers of all payload types
+      {
+        size_t sizes[] = { std::get<detail::type_index<Ts, Ts...>::value>(Messages).size()... };
+        size_t sum{0};
+        for (auto size: sizes)
+          sum += size;
+        return sum;
+      }
+
+    private:
+      template <typename T, typename U, typename ...Us>
+      bool deliver(size_t index, const void* data, size_t size)
+        // unrolled at compile time, the deliveries get inlined unlike calls through a table of function pointers
+      { return index == 0 ? deliver<T>(index, data, size) : deliver<U, Us...>(index - 1, data, size); }
+
+      template <typename T>
+      bool deliver(size_t, const void* data, size_t size)
+      {
+        if (size < sizeof(T))
+          return reject();
+
+        ++Dispatched;
+        auto packet = static_cast<const T*>(data);
+        alignas(T) unsigned char copy[sizeof(T)];
+          // raw storage, T needs no default constructor and aligned packets are not touched
+        if (reinterpret_cast<std::uintptr_t>(data) % alignof(T) != 0)
+        {
+          ++Copied;
+          std::memcpy(copy, data, sizeof(T));
+          packet = reinterpret_cast<const T*>(copy);
+        }
+
+        payload<T>().send(*packet);
+        return true;
+      }
+
+      bool reject() 
+      { 
+        ++Rejected; 
+        return false; 
+      }
+
+      std::tuple<payload_message<Ts>...> Messages;
+      size_t Dispatched{0};
+      size_t Copied    {0};
+      size_t Rejected  {0};
+  };
+}
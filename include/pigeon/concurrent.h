@@ -0,0 +1,504 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+concurrent.h:
+concurrent_message is a message that may be sent from several threads at once,
+while other threads deliver to it and drop from it.
+Every pigeon still belongs to one thread, deliver and drop through it there.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace pigeon 
+{
+  namespace detail
+  {
+    class read_side
+      // Userspace RCU: a reader only increments and decrements a counter of the current epoch.
+      // advance flips the epoch once the readers of the previous epoch have left, without waiting.
+      // Whatever was unpublished at epoch e is unreachable for every reader once epoch() >= e + 3,
+      // synchronize advances until then.
+      // The counters are spread over cache lines, so readers of different threads do not collide.
+    {
+      public:
+        class section
+          // Read-side critical section, sections of a thread may nest
+        {
+          public:
+            explicit section(read_side& side)
+             :Side(side), Readers(side.enter()), Previous(active()) 
+            { active() = this; }
+
+           ~section() { active() = Previous; Readers->fetch_sub(1); }
+
+            section(section const&) = delete;
+            section& operator=(section const&) = delete;
+
+            bool isDropped(void const* p) const
+              // p was dropped on this thread while inside this section
+            { return not Dropped.empty() and std::find(Dropped.begin(), Dropped.end(), p) != Dropped.end(); }
+
+          private:
+            friend class read_side;
+
+            read_side&               Side;
+            std::atomic<size_t>*     Readers;
+            section*                 Previous;  // the enclosing section of this thread
+            std::vector<void const*> Dropped;   // only touched by the thread of the section
+        };
+
+        bool isReading() const
+          // The current thread is inside a section of this read_side
+        {
+          for (auto s = active(); s; s = s->Previous)
+            if (&s->Side == this)
+              return true;
+
+          return false;
+        }
+
+        void dropped(void const* p)
+          // Remembers p in every section of this read_side the current thread is inside,
+          // so the sends of these sections skip it
+        {
+          for (auto s = active(); s; s = s->Previous)
+            if (&s->Side == this)
+              s->Dropped.push_back(p);
+        }
+
+        static bool isInside()
+          // The current thread is inside a section of any read_side
+        { return active() != nullptr; }
+
+        size_t epoch() const { return Epoch.load(); }
+
+        bool advance()
+        {
+          std::unique_lock<std::mutex> lock{Flipping, std::try_to_lock};
+          if (not lock)
+            return false;
+
+          auto epoch = Epoch.load();
+          for (auto& counter: Counters[(epoch + 1) & 1])
+            if (counter.Readers.load())
+              return false;
+
+          Epoch.store(epoch + 1);
+          return true;
+        }
+
+        void synchronize()
+          // Waits for the readers, must not be called inside a section of this read_side
+        {
+          auto target = Epoch.load() + 3;
+          while (Epoch.load() < target)
+            if (not advance())
+              std::this_thread::yield();
+        }
+
+      private:
+        static const size_t Stripes = 8;
+
+        struct counter
+        {
+          std::atomic<size_t> Readers{0};
+          char Padding[64 - sizeof (std::atomic<size_t>)];
+        };
+
+        std::atomic<size_t> Epoch{0};
+        counter             Counters[2][Stripes];
+        std::mutex          Flipping;  // a flip and the check before it must not interleave with another one
+
+        std::atomic<size_t>* enter()
+        {
+          auto& readers = Counters[Epoch.load() & 1][stripe()].Readers;
+          readers.fetch_add(1);
+          return &readers;
+        }
+
+        static section*& active()
+        {
+          static thread_local section* Active{nullptr};
+          return Active;
+        }
+
+        static size_t stripe()
+        {
+          static thread_local size_t Stripe{std::hash<std::thread::id>{}(std::this_thread::get_id()) % Stripes};
+          return Stripe;
+        }
+    };
+  } // namespace detail
+
+  template <typename R, typename ...Args>
+  class concurrent_message<R(Args...)>: detail::sender_storage<detail::sender<R, Args...>>
+    // send and response traverse an immutable snapshot of the senders without taking a lock.
+    // deliver and drop publish a new snapshot, the old one is freed once no send uses it anymore.
+    // deliver never waits for the sends. drop and clear wait,
+    // so once they return, the handler is not running on any thread and will not run again.
+    // Handlers may run on several threads at once and must be thread-safe.
+    //
+    // Inside a handler of any concurrent_message drop and clear do not wait, 
+    // two handlers waiting for each other's message would wait forever.
+    // The sender is destructed later by the message instead.
+    // clear, destruction and drop(token) of the message must not race with the pigeons of its senders.
+  {
+      using sender_type = detail::sender<R, Args...>;
+
+    public:
+      concurrent_message() = default;
+      concurrent_message(concurrent_message const&):concurrent_message() { }  // a copy starts without senders
+     ~concurrent_message() 
+      { 
+        clear(); 
+        Readers.synchronize();  // only waits for the sends of this message, there are none left
+        reclaim(false);
+      }
+
+      bool isSending() const { return Readers.isReading(); }
+        // The current thread is sending this message
+
+      size_t size           () const { return Live.load(); }
+      bool   has_subscribers() const { return Live.load() != 0; }
+
+      void clear()
+      {
+        ensureNotSending();
+
+        snapshot* current;
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          current = Current.exchange(nullptr);
+          Live = 0;
+          if (not current)
+            return;
+          current->Epoch = Readers.epoch();
+        }
+
+        if (not detail::read_side::isInside())
+          Readers.synchronize();
+
+        for (size_t index = current->Size; index--; )
+          current->senders()[index]->drop(who::message);
+          // detach finds the sender in no snapshot anymore and only lets go of it
+
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          current->Next = RetiredSnapshots;
+          RetiredSnapshots = current;
+        }
+        reclaim(false);
+      }
+
+      bool drop(contact_token token)
+        // O(1), its pigeon may be gone already, the table of the token is recycled but not freed
+      {
+        auto contact = token.Table ? token.Table->find(token) : nullptr;
+        if (not this->owns(contact))
+          return false;
+
+        contact->drop(who::message);
+        return true;
+      }
+
+      template <typename H>
+      void response(Args...args, H&& h) 
+      { 
+        // Same as message, we purposely silently ignore reentrant responding through user provided handlers
+        if (isSending())
+          return;
+
+        typename detail::read_side::section section{Readers};
+        auto current = Current.load();
+        if (not current)
+          return;
+
+        // The senders are stored in delivery order, the last delivered one is sent first.
+        // repeat starts over behind the active sender, without reordering the snapshot.
+        auto senders = current->senders();
+        auto size    = current->Size;
+        auto count   = size;
+        auto index   = size;
+        while(count--)
+        {
+          index = (index ? index : size) - 1;
+          if (section.isDropped(senders[index]))
+            continue;  // dropped by a handler of this send, like message does
+
+          switch(senders[index]->template do_send<R>(h, detail::hand_over<Args>::of(args, size == 1)...))
+          {
+            case iteration_state::dead:
+            case iteration_state::progress:
+              break;
+
+            case iteration_state::repeat:
+              count = size - 1;
+              break;
+
+            case iteration_state::finish:
+              count = 0;
+              break;
+          }
+        }
+      }
+
+      void send(Args ...args) 
+      { response(std::forward<Args>(args)... , [](...){ }); }
+
+    private:
+      friend class pigeon;
+
+      void ensureNotSending() const
+      {
+        if (isSending())
+          throw std::logic_error("Logic error while delivering");
+      }
+
+      struct snapshot
+        // Immutable once published, the sender pointers follow the header
+      {
+        snapshot* Next {nullptr};  // in the list of retired snapshots
+        size_t    Epoch{0};        // of the read_side when it was unpublished
+        size_t    Size;
+
+        sender_type** senders() { return reinterpret_cast<sender_type**>(this + 1); }
+
+        static snapshot* create(size_t size)
+        {
+          auto memory = ::operator new(sizeof (snapshot) + size * sizeof (sender_type*));
+          auto s = new (memory) snapshot;
+          s->Size = size;
+          return s;
+        }
+
+        static void destroy(snapshot* s) { ::operator delete(s); }
+      };
+
+      std::atomic<snapshot*> Current{nullptr};
+      std::atomic<size_t>    Live   {0};
+      detail::read_side      Readers;
+
+      struct retired
+      {
+        sender_type* Sender;
+        size_t       Epoch;  // of the read_side when it was unpublished
+      };
+
+      std::mutex           Mutex;  // serializes publishing, guards the retired lists
+      snapshot*            RetiredSnapshots{nullptr};
+      std::vector<retired> RetiredSenders;  // dropped inside a handler of a concurrent_message
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, allocator* alloc, F&& f)
+      {
+        auto space = alloc->allocate(sizeof (I), alignof(I));
+        return new (space) I{std::forward<H>(handler), alloc, std::forward<F>(f)};
+      }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, F&& f, std::true_type /* over-aligned */)
+      { return make_inbox<I>(std::forward<H>(handler), &detail::aligned_heap::instance(), std::forward<F>(f)); }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, F&& f, std::false_type)
+      {
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+        return new detail::inbox<handler_type, drop_type, R, Args...>{std::forward<H>(handler), std::forward<F>(f)};
+      }
+
+      template<typename H, typename F>
+      detail::contact* make_contact(H&& handler, allocator* alloc, F&& f, std::int16_t priority)
+      {
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+
+        using inbox_type = detail::inbox_with_allocator<handler_type, drop_type, R, Args...>;
+
+        sender_type* sender;
+        if (alloc)
+          sender = make_inbox<inbox_type>(std::forward<H>(handler), alloc, std::forward<F>(f));
+        else
+          sender = make_inbox<inbox_type>(std::forward<H>(handler), std::forward<F>(f), 
+            std::integral_constant<bool, (alignof(inbox_type) > alignof(std::max_align_t))>{});
+
+        return insert(sender, priority);
+      }
+
+      template<typename H, typename P, typename F>
+      detail::contact* make_contact(H&& handler, detail::policy<P>, F&& f, std::int16_t priority)
+      {
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+        using inbox_type   = detail::inbox_with_policy<P, handler_type, drop_type, R, Args...>;
+
+        auto space = P::allocate(sizeof (inbox_type), alignof(inbox_type));
+        return insert(new (space) inbox_type{std::forward<H>(handler), std::forward<F>(f)}, priority);
+      }
+
+      detail::contact* insert(sender_type* sender, std::int16_t priority)
+      {
+        sender->Message  = this->self();
+        sender->Priority = priority;
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          auto current = Current.load();
+          auto size    = current ? current->Size : 0;
+          auto next    = snapshot::create(size + 1);
+
+          // sent from the back, so behind the senders with lower or equal priority
+          size_t position{0};
+          while (position < size and current->senders()[position]->Priority <= priority)
+            ++position;
+
+          for (size_t index = 0, target = 0; index < size; ++index, ++target)
+          {
+            if (index == position)
+              ++target;
+            next->senders()[target] = current->senders()[index];
+          }
+
+          next->senders()[position] = sender;
+          publish(next);
+          ++Live;
+        }
+
+        reclaim(false);
+        return sender;
+      }
+
+      bool detach(sender_type* sender) override
+      {
+        auto inside = detail::read_side::isInside();
+        auto found  = false;
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          auto current = Current.load();
+          auto size    = current ? current->Size : 0;
+          auto senders = current ? current->senders() : nullptr;
+          found = std::find(senders, senders + size, sender) != senders + size;
+            // otherwise clear unpublished it already and waited if it could
+
+          if (found)
+          {
+            auto next = size > 1 ? snapshot::create(size - 1) : nullptr;
+            size_t count{0};
+            for (size_t index = 0; index < size; ++index)
+              if (senders[index] != sender)
+                next->senders()[count++] = senders[index];
+
+            publish(next);
+            --Live;
+          }
+          sender->Message = nullptr;
+
+          if (inside)
+          {
+            Readers.dropped(sender);
+            RetiredSenders.push_back(retired{sender, Readers.epoch()});
+          }
+        }
+
+        reclaim(found and not inside);
+        return not inside;
+      }
+
+      void publish(snapshot* next)
+        // Mutex must be locked
+      {
+        if (auto previous = Current.exchange(next))
+        {
+          previous->Epoch  = Readers.epoch();
+          previous->Next   = RetiredSnapshots;
+          RetiredSnapshots = previous;
+        }
+      }
+
+      void reclaim(bool wait)
+        // Frees what is retired, once no send can use it anymore.
+        // Waits for the sends only if asked to and not inside a handler of a concurrent_message
+      {
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          if (not RetiredSnapshots and RetiredSenders.empty())
+            return;
+        }
+
+        if (wait and not detail::read_side::isInside())
+          Readers.synchronize();
+        else
+          Readers.advance();
+
+        auto now = Readers.epoch();
+        auto unreachable = [now](size_t epoch) { return epoch + 3 <= now; };
+
+        snapshot* snapshots{nullptr};
+        std::vector<sender_type*> senders;
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          for (auto link = &RetiredSnapshots; *link; )
+          {
+            auto retiree = *link;
+            if (not unreachable(retiree->Epoch))
+            {
+              link = &retiree->Next;
+              continue;
+            }
+            *link = retiree->Next;
+            retiree->Next = snapshots;
+            snapshots = retiree;
+          }
+
+          auto kept = std::partition(RetiredSenders.begin(), RetiredSenders.end(), 
+                        [&unreachable](retired const& r) { return not unreachable(r.Epoch); });
+          for (auto it = kept; it != RetiredSenders.end(); ++it)
+            senders.push_back(it->Sender);
+          RetiredSenders.erase(kept, RetiredSenders.end());
+        }
+
+        while(snapshots)
+        {
+          auto next = snapshots->Next;
+          snapshot::destroy(snapshots);
+          snapshots = next;
+        }
+
+        for (auto sender: senders)
+          sender->destruct();
+      }
+  };
+} // namespace pigeon
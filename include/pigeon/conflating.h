@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+
+/*
+conflating.h:
+conflating_message keeps only the latest value per key between flushes, 
+flush sends each pending key once to the subscribers of flushed().
+A burst of updates to few keys costs one handler call per key and subscriber.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace pigeon 
+{
+  struct conflation_stats
+  {
+    size_t Updates  {0};  // every update
+    size_t Conflated{0};  // updates that replaced a pending value of the same key
+    size_t Flushed  {0};  // values sent by flush
+    size_t Flushes  {0};  // flushes with at least one pending value
+  };
+
+  template <typename Key, typename Value, typename = global_access, typename = list_storage, typename = std::hash<Key>> 
+  class conflating_message;
+
+  template <typename Key, typename Value, typename S, typename Hash>
+  class conflating_message<Key, Value, protected_access, S, Hash>
+  {
+    public:
+      using message_type = message<void(Key const&, Value const&), conflating_message, S>;
+
+      message_type& flushed() { return Message; }
+        // The message flush sends to, deliver to it to subscribe
+
+      bool isSending() const { return Flushing; }
+
+      conflation_stats const& stats() const { return Stats; }
+      void reset_stats() { Stats = conflation_stats{}; }
+
+    protected:
+      size_t size           () const { return Message.size(); }
+      bool   has_subscribers() const { return Message.has_subscribers(); }
+      size_t pending        () const { return Pending.size(); }
+
+      void clear() { Message.clear(); }
+      bool drop(contact_token token) { return Message.drop(token); }
+
+      template <typename K, typename V>
+      void update(K&& key, V&& value)
+        // Replaces the pending value of key, keys keep the order of their first update
+      {
+        ++Stats.Updates;
+        auto found = Index.find(key);
+        if (found != Index.end())
+        {
+          ++Stats.Conflated;
+          Pending[found->second].second = std::forward<V>(value);
+          return;
+        }
+
+        Pending.emplace_back(std::forward<K>(key), std::forward<V>(value));
+        Index.emplace(Pending.back().first, Pending.size() - 1);
+      }
+
+      size_t flush()
+        // Updates from handlers wait for the next flush, a reentrant flush is ignored.
+        // When a handler throws, the values not sent yet are gone.
+      {
+        if (Flushing or Pending.empty())
+          return 0;
+
+        Flushing = true;
+        ++Stats.Flushes;
+        Sending.swap(Pending);
+        Index.clear();
+
+        struct guard
+        {
+          conflating_message& Self;
+         ~guard() { Self.Sending.clear(); Self.Flushing = false; }
+        } g{*this};
+
+        for (auto const& entry: Sending)
+        {
+          ++Stats.Flushed;
+          Message.send(entry.first, entry.second);
+        }
+        return Sending.size();
+      }
+
+      void discard()
+        // Drops the pending values without sending them
+      {
+        if (Flushing)
+          throw std::logic_error("Logic error while flushing");
+
+        Pending.clear();
+        Index.clear();
+      }
+
+    private:
+      using entry = std::pair<Key, Value>;
+
+      message_type Message;
+      std::vector<entry> Pending;
+      std::vector<entry> Sending;  // keeps its capacity between flushes
+      std::unordered_map<Key, size_t, Hash> Index;  // key to its position in Pending
+      conflation_stats Stats;
+      bool Flushing{false};
+  };
+
+  template <typename Key, typename Value, typename S, typename Hash>
+  struct conflating_message<Key, Value, global_access, S, Hash>: conflating_message<Key, Value, protected_access, S, Hash>
+  {
+    using base = conflating_message<Key, Value, protected_access, S, Hash>;
+    using base::size;
+    using base::has_subscribers;
+    using base::pending;
+    using base::clear;
+    using base::drop;
+    using base::update;
+    using base::flush;
+    using base::discard;
+  };
+
+  template <typename Key, typename Value, typename F, typename S, typename Hash>
+  class conflating_message: public conflating_message<Key, Value, protected_access, S, Hash>
+  { 
+    protected:
+      friend F;
+
+      using base = conflating_message<Key, Value, protected_access, S, Hash>;
+      using base::size;
+      using base::has_subscribers;
+      using base::pending;
+      using base::clear;
+      using base::drop;
+      using base::update;
+      using base::flush;
+      using base::discard;
+  };
+}
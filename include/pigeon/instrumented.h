@@ -0,0 +1,137 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/*
+instrumented.h:
+instrumented_allocator<A> counts what the allocator A hands out: live allocations,
+the high-water mark, bytes lost to padding and a breakdown per inbox size.
+The inboxes of one handler type all have the same size and alignment,
+so the breakdown shows which handlers take the memory.
+Define PIGEON_ALLOCATOR_STATS as 0 to compile the counting out, 
+the statistics stay available and report zero.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <vector>
+
+#ifndef PIGEON_ALLOCATOR_STATS
+  #define PIGEON_ALLOCATOR_STATS 1
+#endif
+
+namespace pigeon 
+{
+  struct allocation_stats
+    // of all allocations with the same size and alignment
+  {
+    size_t Size;
+    size_t Alignment;
+    size_t Live;
+    size_t Peak;
+    size_t Total;
+  };
+
+  namespace detail
+  {
+    template <typename A>
+    auto used_bytes(A const& alloc, int) -> decltype(size_t{alloc.used()}) { return alloc.used(); }
+
+    template <typename A>
+    size_t used_bytes(A const&, long) { return 0; }
+  }
+
+  template <typename A>
+  class instrumented_allocator: public A
+    // A decorator for any allocator type A, e.g. allocator_pigeon<instrumented_allocator<pool_allocator<>>>
+  {
+    public:
+      using A::A;
+
+      void* allocate(size_t size_bytes, size_t alignment) override
+      {
+#if PIGEON_ALLOCATOR_STATS
+        auto before  = detail::used_bytes(static_cast<A const&>(*this), 0);
+        auto pointer = A::allocate(size_bytes, alignment);
+        auto after   = detail::used_bytes(static_cast<A const&>(*this), 0);
+        if (after > before + size_bytes)
+          Wasted += after - before - size_bytes;  // padding and rounding, if A tells its used bytes
+
+        ++Live;
+        ++Total;
+        LiveBytes += size_bytes;
+        if (LiveBytes > PeakBytes)
+          PeakBytes = LiveBytes;
+
+        auto& stats = find(size_bytes, alignment);
+        ++stats.Total;
+        if (++stats.Live > stats.Peak)
+          stats.Peak = stats.Live;
+        return pointer;
+#else
+        return A::allocate(size_bytes, alignment);
+#endif
+      }
+
+      void deallocate(void* pointer, size_t size_bytes, size_t alignment) override
+      {
+#if PIGEON_ALLOCATOR_STATS
+        --Live;
+        LiveBytes -= size_bytes;
+        --find(size_bytes, alignment).Live;
+#endif
+        A::deallocate(pointer, size_bytes, alignment);
+      }
+
+      size_t live_allocations () const { return Live;      }
+      size_t total_allocations() const { return Total;     }
+      size_t live_bytes       () const { return LiveBytes; }  // as requested, without padding
+      size_t peak_bytes       () const { return PeakBytes; }  // high-water mark of live_bytes
+      size_t wasted_bytes     () const { return Wasted;    }  // padding and rounding of all allocations so far
+
+      std::vector<allocation_stats> const& by_size() const { return BySize; }
+
+    private:
+      allocation_stats& find(size_t size_bytes, size_t alignment)
+      {
+        // few handler types per allocator, a linear search is fine
+        for (auto& stats: BySize)
+          if (stats.Size == size_bytes and stats.Alignment == alignment)
+            return stats;
+
+        BySize.push_back(allocation_stats{size_bytes, alignment, 0, 0, 0});
+        return BySize.back();
+      }
+
+      size_t Live     {0};
+      size_t Total    {0};
+      size_t LiveBytes{0};
+      size_t PeakBytes{0};
+      size_t Wasted   {0};
+      std::vector<allocation_stats> BySize;
+  };
+}
@@ -0,0 +1,432 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+mailbox.h:
+A mailbox_pigeon receives messages sent on other threads. 
+send only queues the arguments, the handlers run when the receiving thread pumps its mailbox.
+So handlers keep running on one thread, the same as with the plain pigeon.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <tuple>
+
+#if defined(__linux__)
+  #include <cerrno>
+  #include <poll.h>
+  #include <sys/eventfd.h>
+  #include <unistd.h>
+#else
+  #include <condition_variable>
+  #include <mutex>
+#endif
+
+namespace pigeon 
+{
+  enum class backpressure 
+  {
+    block,  // send waits until the receiver made room, a handler posting to its own full mailbox is rejected
+    reject  // send discards the arguments and counts them as rejected
+  };
+
+  namespace detail
+  {
+#if defined(__linux__)
+    class wakeup
+      // eventfd, the receiver may also wait on native_handle() in its own poll loop
+    {
+      public:
+        wakeup():Fd{::eventfd(0, EFD_CLOEXEC)} 
+        { 
+          if (Fd < 0) 
+            throw std::system_error(errno, std::system_category(), "eventfd"); 
+        }
+       ~wakeup() { ::close(Fd); }
+
+        wakeup(wakeup const&) = delete;
+        wakeup& operator=(wakeup const&) = delete;
+
+        void notify()
+        {
+          std::uint64_t one{1};
+          auto written = ::write(Fd, &one, sizeof one);
+          (void)written;  // only fails if the counter overflows, then the receiver is awake anyway
+        }
+
+        void wait(std::chrono::milliseconds timeout)
+        {
+          pollfd request{Fd, POLLIN, 0};
+          if (::poll(&request, 1, static_cast<int>(timeout.count())) > 0)
+          {
+            std::uint64_t count;
+            auto read = ::read(Fd, &count, sizeof count);
+            (void)read;
+          }
+        }
+
+        int native_handle() const { return Fd; }
+
+      private:
+        int Fd;
+    };
+#else
+    class wakeup
+    {
+      public:
+        void notify()
+        {
+          std::lock_guard<std::mutex> lock{Mutex};
+          Notified = true;
+          Condition.notify_one();
+        }
+
+        void wait(std::chrono::milliseconds timeout)
+        {
+          std::unique_lock<std::mutex> lock{Mutex};
+          Condition.wait_for(lock, timeout, [this] { return Notified; });
+          Notified = false;
+        }
+
+      private:
+        std::mutex              Mutex;
+        std::condition_variable Condition;
+        bool                    Notified{false};
+    };
+#endif
+
+    template <typename H>
+    struct mail_inlet
+      // Shared by a queued handler and the mails queued for it.
+      // A mail for a dropped handler is discarded instead of run.
+    {
+      template <typename I>
+      explicit mail_inlet(I&& handler):Handler(std::forward<I>(handler)) { }
+
+      std::atomic<size_t> References{1};
+      std::atomic<bool>   Open      {true};
+      H                   Handler;
+
+      void acquire() { References.fetch_add(1, std::memory_order_relaxed); }
+      void release() 
+      { 
+        if (References.fetch_sub(1, std::memory_order_acq_rel) == 1) 
+          delete this; 
+      }
+    };
+  } // namespace detail
+
+  class mailbox
+    // Bounded multi producer single consumer ring of mails, lock-free for the producers.
+    // Small mails live right in the ring, bigger ones in a heap box.
+  {
+    public:
+      static const size_t MailSize = 8 * sizeof(void*);
+
+      explicit mailbox(size_t capacity = 1024, backpressure policy = backpressure::block)
+       :Policy{policy}
+      {
+        Capacity = 2;
+        while (Capacity < capacity)
+          Capacity *= 2;
+
+        Cells = new cell[Capacity];
+        for (size_t index = 0; index < Capacity; ++index)
+          Cells[index].Sequence.store(index, std::memory_order_relaxed);
+      }
+
+     ~mailbox() 
+      { 
+        // discard what is left
+        while (pump_one(false)) { } 
+        delete[] Cells; 
+      }
+
+      mailbox(mailbox const&) = delete;
+      mailbox& operator=(mailbox const&) = delete;
+
+      size_t pump(size_t max = ~size_t{0})
+        // Takes up to max mails on the calling thread, the receiving one, and runs them.
+        // Mails of dropped handlers are discarded. Returns how many mails it took.
+      {
+        struct pumping 
+        { 
+          std::atomic<std::thread::id>& Pumper; 
+          std::thread::id               Previous; 
+         ~pumping() { Pumper.store(Previous); } 
+        } guard{Pumper, Pumper.exchange(std::this_thread::get_id())};
+
+        size_t count{0};
+        while (count < max and pump_one(true))
+          ++count;
+
+        return count;
+      }
+
+      bool wait(std::chrono::milliseconds timeout)
+        // Blocks the receiving thread until mail arrives or timeout, returns if there is mail
+      {
+        if (not empty())
+          return true;
+
+        Sleeping.store(true);
+        if (empty())
+          Wakeup.wait(timeout);
+
+        Sleeping.store(false);
+        return not empty();
+      }
+
+      bool empty() const
+      {
+        auto& cell = Cells[Tail & (Capacity - 1)];
+        return cell.Sequence.load() != Tail + 1;
+      }
+
+      size_t capacity() const { return Capacity; }
+      size_t rejected() const { return Rejected.load(std::memory_order_relaxed); }
+
+#if defined(__linux__)
+      int native_handle() const { return Wakeup.native_handle(); }
+#endif
+
+      template <typename H, typename ...Args>
+      bool post(detail::mail_inlet<H>* inlet, Args&& ...args)
+        // Called by the sending threads, false if the mail got rejected
+      {
+        using mail_type = mail<H, typename std::decay<Args>::type...>;
+
+        cell* target;
+        auto head = Head.load(std::memory_order_relaxed);
+        for (;;)
+        {
+          target = &Cells[head & (Capacity - 1)];
+          auto sequence = target->Sequence.load(std::memory_order_acquire);
+          if (sequence == head)
+          {
+            if (Head.compare_exchange_weak(head, head + 1, std::memory_order_relaxed))
+              break;
+          }
+          else if (static_cast<std::ptrdiff_t>(sequence - head) < 0)  // full
+          {
+            // The pumping thread itself would wait for itself forever
+            if (Policy == backpressure::reject or Pumper.load() == std::this_thread::get_id())
+            {
+              Rejected.fetch_add(1, std::memory_order_relaxed);
+              return false;
+            }
+            std::this_thread::yield();
+            head = Head.load(std::memory_order_relaxed);
+          }
+          else
+            head = Head.load(std::memory_order_relaxed);
+        }
+
+        inlet->acquire();
+        emplace<mail_type>(*target, std::integral_constant<bool, fits<mail_type>::value>{}, 
+          inlet, std::forward<Args>(args)...);
+        target->Sequence.store(head + 1);
+
+        if (Sleeping.load())
+          Wakeup.notify();
+
+        return true;
+      }
+
+    private:
+      using run_type = void (*)(void* mail, bool run, mailbox& box);
+        // Moves the mail out of its cell and releases the cell, 
+        // then runs the mail if run is true and destroys it in any case.
+        // So a handler finds its cell free already, when it posts or pumps again.
+
+      struct cell
+      {
+        std::atomic<size_t> Sequence;
+        run_type            Run;
+        alignas(std::max_align_t) unsigned char Mail[MailSize];
+      };
+
+      template <typename T> struct fits
+      {
+        static const bool value = (sizeof (T) <= MailSize) and (alignof(T) <= alignof(std::max_align_t));
+      };
+
+      template <typename H, typename ...Args>
+      struct mail
+      {
+        detail::mail_inlet<H>* Inlet;
+        std::tuple<Args...>    Arguments;
+
+        template <size_t ...I>
+        void deliver(detail::indices<I...>) { Inlet->Handler(std::get<I>(Arguments)...); }
+
+        void finish(bool run)
+        {
+          if (run and Inlet->Open.load(std::memory_order_acquire))
+            deliver(typename detail::make_indices<sizeof...(Args)>::type{});
+
+          Inlet->release();
+        }
+
+        static void run(void* memory, bool run, mailbox& box)
+        {
+          auto self = static_cast<mail*>(memory);
+          mail taken{std::move(*self)};
+          self->~mail();
+          box.release_cell();
+          taken.finish(run);
+        }
+
+        static void run_boxed(void* memory, bool run, mailbox& box)
+        {
+          auto self = *static_cast<mail**>(memory);
+          box.release_cell();
+          self->finish(run);
+          self->~mail();
+          ::operator delete(self);
+        }
+      };
+
+      template <typename M, typename I, typename ...Args>
+      static void emplace(cell& target, std::true_type /* fits into the cell */, I* inlet, Args&& ...args)
+      {
+        new (target.Mail) M{inlet, decltype(M::Arguments){std::forward<Args>(args)...}};
+        target.Run = &M::run;
+      }
+
+      template <typename M, typename I, typename ...Args>
+      static void emplace(cell& target, std::false_type /* too big for the cell */, I* inlet, Args&& ...args)
+      {
+        auto box = new (::operator new(sizeof (M))) M{inlet, decltype(M::Arguments){std::forward<Args>(args)...}};
+        new (target.Mail) M*{box};
+        target.Run = &M::run_boxed;
+      }
+
+      bool pump_one(bool run)
+      {
+        auto& target = Cells[Tail & (Capacity - 1)];
+        if (target.Sequence.load(std::memory_order_acquire) != Tail + 1)
+          return false;
+
+        target.Run(target.Mail, run, *this);
+        return true;
+      }
+
+      void release_cell()
+        // The cell at Tail is empty again, senders may reuse it
+      {
+        Cells[Tail & (Capacity - 1)].Sequence.store(Tail + Capacity, std::memory_order_release);
+        ++Tail;
+      }
+
+      cell*               Cells;
+      size_t              Capacity;
+      backpressure        Policy;
+      std::atomic<size_t> Head    {0};  // next cell to claim by a sender
+      size_t              Tail    {0};  // next cell to pump, receiving thread only
+      std::atomic<size_t> Rejected{0};
+      std::atomic<bool>   Sleeping{false};
+      detail::wakeup      Wakeup;
+
+      std::atomic<std::thread::id> Pumper{std::thread::id{}};  // the thread inside pump, if any
+  };
+
+  namespace detail
+  {
+    template <typename H>
+    class queued_handler
+      // Stands in for the handler inside the message, 
+      // the handler itself only runs when the mailbox is pumped.
+      // A send does not learn about rejected mail, only mailbox::rejected() counts it.
+    {
+      public:
+        template <typename I>
+        queued_handler(mailbox& box, I&& handler)
+         :Mailbox{&box}, Inlet{new mail_inlet<H>{std::forward<I>(handler)}} { }
+
+        queued_handler(queued_handler&& other):Mailbox{other.Mailbox}, Inlet{other.Inlet} { other.Inlet = nullptr; }
+        queued_handler(queued_handler const&) = delete;
+
+       ~queued_handler()
+        {
+          if (Inlet)
+          {
+            Inlet->Open.store(false, std::memory_order_release);
+            Inlet->release();
+          }
+        }
+
+        template <typename ...Args>
+        void operator()(Args&& ...args) { Mailbox->post(Inlet, std::forward<Args>(args)...); }
+
+      private:
+        mailbox*       Mailbox;
+        mail_inlet<H>* Inlet;
+    };
+  } // namespace detail
+
+  class mailbox_pigeon: pigeon
+    // A pigeon whose handlers run on its own thread, whenever it pumps its mailbox. 
+    // Send on other threads through a concurrent_message, or a message
+    // whose deliver and drop do not race with its sends.
+    // Handlers get copies of the arguments and the message return type must be void.
+  {
+      using base = pigeon;
+
+    public:
+      explicit mailbox_pigeon(size_t capacity = 1024, backpressure policy = backpressure::block)
+       :Mailbox{capacity, policy} { }
+     ~mailbox_pigeon() { clear(); }
+
+      using base::size;
+      using base::has_subscribers;
+      using base::clear;
+      using base::drop;
+
+      template <typename M, typename I, typename F = detail::noop>
+      contact_token deliver(M& message, I&& handler, F&& f = F{}) 
+      {
+        using handler_type = typename std::decay<I>::type;
+        return base::deliver(message, detail::queued_handler<handler_type>{Mailbox, std::forward<I>(handler)}, 
+          nullptr, std::forward<F>(f));
+      }
+
+      size_t pump(size_t max = ~size_t{0})           { return Mailbox.pump(max); }
+      bool   wait(std::chrono::milliseconds timeout) { return Mailbox.wait(timeout); }
+
+      mailbox&       inbox()       { return Mailbox; }
+      mailbox const& inbox() const { return Mailbox; }
+
+    private:
+      mailbox Mailbox;  // destructed after clear, no handler can post anymore
+  };
+} // namespace pigeon
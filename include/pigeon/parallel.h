@@ -0,0 +1,420 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+/*
+parallel.h:
+parallel_send and parallel_response fan one send out over a work-stealing thread_pool.
+Only handlers marked with pigeon::thread_safe run on the pool, 
+all others run on the calling thread meanwhile.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace pigeon 
+{
+  class thread_pool
+    // Work-stealing: every worker owns a deque of index ranges. A worker splits its newest range 
+    // and keeps the halves in its deque, idle workers steal the oldest, biggest ranges of the others.
+  {
+    public:
+      explicit thread_pool(size_t threads = std::thread::hardware_concurrency())
+      {
+        for (size_t index = 0; index <= threads; ++index)
+          Queues.emplace_back(new queue);
+
+        for (size_t index = 0; index < threads; ++index)
+          Threads.emplace_back([this, index] { work(index); });
+      }
+
+     ~thread_pool()
+      {
+        {
+          std::lock_guard<std::mutex> lock{Sleep};
+          Stopping = true;
+        }
+        Wake.notify_all();
+
+        for (auto& thread: Threads)
+          thread.join();
+      }
+
+      thread_pool(thread_pool const&) = delete;
+      thread_pool& operator=(thread_pool const&) = delete;
+
+      size_t size() const { return Threads.size(); }
+
+      template <typename F, typename G>
+      void parallel_for(size_t count, F&& f, G&& meanwhile)
+        // Calls f(index) for every index in [0, count) on the pool and meanwhile() on the calling thread,
+        // which helps the pool afterwards. Returns after all calls.
+        // The first exception thrown is rethrown here, after all calls.
+      {
+        job_for<F> job{f, count};
+        if (count)
+          push(outside(), range{&job, 0, count});
+
+        try
+        {
+          meanwhile();
+        }
+        catch(...)
+        {
+          job.fail();
+        }
+
+        range r;
+        while (job.Remaining.load() != 0)
+          if (take(outside(), r))
+            execute(outside(), r);
+          else
+            std::this_thread::yield();
+
+        if (job.Error)
+          std::rethrow_exception(job.Error);
+      }
+
+      template <typename F>
+      void parallel_for(size_t count, F&& f) { parallel_for(count, std::forward<F>(f), []{ }); }
+
+    private:
+      struct job
+      {
+        explicit job(size_t count):Remaining{count} { }
+
+        virtual void call(size_t index) = 0;
+
+        void fail()
+        {
+          if (not Failed.exchange(true))
+            Error = std::current_exception();
+        }
+
+        std::atomic<size_t> Remaining;
+        std::atomic<bool>   Failed{false};
+        std::exception_ptr  Error;
+
+        protected:
+         ~job() = default;
+      };
+
+      template <typename F>
+      struct job_for final: job
+      {
+        job_for(F& f, size_t count):job{count}, Function(f) { }
+        void call(size_t index) override { Function(index); }
+        F& Function;
+      };
+
+      struct range
+      {
+        job*   Job;
+        size_t First;
+        size_t Last;
+      };
+
+      struct queue
+      {
+        std::mutex        Mutex;
+        std::deque<range> Ranges;
+      };
+
+      std::vector<std::unique_ptr<queue>> Queues;  // one per worker, the last one for the calling threads
+      std::vector<std::thread>            Threads;
+      std::atomic<size_t>                 Queued{0};  // ranges in all queues
+      std::mutex                          Sleep;
+      std::condition_variable             Wake;
+      bool                                Stopping{false};
+
+      size_t outside() const { return Threads.size(); }
+
+      void work(size_t self)
+      {
+        range r;
+        for (;;)
+        {
+          if (take(self, r))
+          {
+            execute(self, r);
+            continue;
+          }
+
+          std::unique_lock<std::mutex> lock{Sleep};
+          Wake.wait(lock, [this] { return Stopping or Queued.load() != 0; });
+          if (Stopping and Queued.load() == 0)
+            return;
+        }
+      }
+
+      void push(size_t self, range r)
+      {
+        {
+          std::lock_guard<std::mutex> lock{Queues[self]->Mutex};
+          Queues[self]->Ranges.push_back(r);
+        }
+        Queued.fetch_add(1);
+
+        // pass the Sleep mutex once, so a worker between its check and its wait does not miss the news
+        {
+          std::lock_guard<std::mutex> lock{Sleep};
+        }
+        Wake.notify_one();
+      }
+
+      bool take(size_t self, range& r)
+      {
+        {
+          auto& own = *Queues[self];
+          std::lock_guard<std::mutex> lock{own.Mutex};
+          if (not own.Ranges.empty())
+          {
+            r = own.Ranges.back();
+            own.Ranges.pop_back();
+            Queued.fetch_sub(1);
+            return true;
+          }
+        }
+
+        for (size_t offset = 1; offset < Queues.size(); ++offset)
+        {
+          auto& other = *Queues[(self + offset) % Queues.size()];
+          std::lock_guard<std::mutex> lock{other.Mutex};
+          if (not other.Ranges.empty())
+          {
+            r = other.Ranges.front();
+            other.Ranges.pop_front();
+            Queued.fetch_sub(1);
+            return true;
+          }
+        }
+
+        return false;
+      }
+
+      void execute(size_t self, range r)
+      {
+        while (r.Last - r.First > 1)
+        {
+          auto middle = r.First + (r.Last - r.First) / 2;
+          push(self, range{r.Job, middle, r.Last});
+          r.Last = middle;
+        }
+
+        try
+        {
+          r.Job->call(r.First);
+        }
+        catch(...)
+        {
+          r.Job->fail();
+        }
+
+        r.Job->Remaining.fetch_sub(1);  // the job may be gone right after
+      }
+  };
+
+  template <typename H>
+  detail::thread_safe_handler<typename std::decay<H>::type> thread_safe(H&& handler)
+    // Marks a handler that may run on any thread and at the same time as the other handlers.
+    // It must not deliver, drop or send through the pigeons and messages of the sending thread.
+  { return detail::thread_safe_handler<typename std::decay<H>::type>{std::forward<H>(handler)}; }
+
+  namespace detail
+  {
+    template <typename ...Args> struct shareable: std::true_type { };
+    template <typename A, typename ...Args> struct shareable<A, Args...>: std::integral_constant<bool,
+      (not std::is_lvalue_reference<A>::value or std::is_const<typename std::remove_reference<A>::type>::value) 
+        and (std::is_reference<A>::value or std::is_copy_constructible<A>::value)
+        and shareable<Args...>::value> { };
+
+    template <typename R>
+    class parallel_results
+      // One result per sender, written by whatever thread runs the sender
+    {
+      static_assert(not std::is_reference<R>::value, "parallel_response does not support references as results");
+
+      public:
+        explicit parallel_results(size_t size):Results{new storage[size]}, Constructed{new bool[size]()}, Size{size} { }
+       ~parallel_results()
+        {
+          for (size_t index = 0; index < Size; ++index)
+            if (Constructed[index])
+              (*this)[index].~R();
+        }
+
+        template <typename C>
+        void run(size_t index, C&& call)
+        {
+          new (&Results[index]) R(call());
+          Constructed[index] = true;
+        }
+
+        R& operator[](size_t index) { return *reinterpret_cast<R*>(&Results[index]); }
+
+        template <typename H>
+        iteration_state hand_out(H& h, size_t index)
+        { return call_handler<R, decltype(h(std::declval<R>()))>::call(h, std::move((*this)[index])); }
+
+      private:
+        using storage = typename std::aligned_storage<sizeof (R), alignof(R)>::type;
+
+        std::unique_ptr<storage[]> Results;
+        std::unique_ptr<bool[]>    Constructed;
+        size_t                     Size;
+    };
+
+    template <>
+    class parallel_results<void>
+    {
+      public:
+        explicit parallel_results(size_t) { }
+
+        template <typename C>
+        void run(size_t, C&& call) { call(); }
+
+        template <typename H>
+        iteration_state hand_out(H& h, size_t) { return call_handler<void, decltype(h())>::call(h); }
+    };
+
+    template <typename R, typename ...Args, typename S>
+    class parallel_sender<message<R(Args...), global_access, S>>
+    {
+      static_assert(shareable<Args...>::value, 
+        "parallel send shares the arguments between threads, non-const references are not allowed "
+        "and every handler copies the arguments taken by value");
+
+      using message_type = message<R(Args...), global_access, S>;
+      using sender_type  = sender<R, Args...>;
+
+      public:
+        template <typename H>
+        static void response(thread_pool& pool, message_type& m, H& h, Args ...args)
+        {
+          // Same as message, we purposely silently ignore reentrant responding through user provided handlers
+          if (m.isSending())
+            return;
+
+          m.Senders.hold([&]
+            {
+              std::vector<sender_type*> senders;
+              m.Senders.for_each([&senders](sender_type& sender)
+                {
+                  if (not sender.isDropped())
+                    senders.push_back(&sender);
+                });
+
+              while (not senders.empty())
+                senders = round(pool, senders, h, pass<Args>(args)...);
+            }
+          );
+        }
+
+      private:
+        template <typename H>
+        static std::vector<sender_type*> round(thread_pool& pool, std::vector<sender_type*> const& senders, 
+          H& h, pass_type<Args> ...args)
+          // Runs every sender once, then hands the results out in delivery order.
+          // Returns the senders of the next round, after a repeat.
+        {
+          parallel_results<R> results(senders.size());
+          auto send = [&](size_t index)
+          {
+            auto sender = senders[index];
+            results.run(index, [&] { return sender->Send(sender, hand_over<Args>::of(args, false)...); });
+          };
+
+          std::vector<size_t> onPool;
+          for (size_t index = 0; index < senders.size(); ++index)
+            if (senders[index]->isThreadSafe())
+              onPool.push_back(index);
+
+          pool.parallel_for(onPool.size(), 
+            [&](size_t index) { send(onPool[index]); },
+            [&] 
+            {
+              for (size_t index = 0; index < senders.size(); ++index)
+                if (not senders[index]->isThreadSafe())
+                  send(index);
+            }
+          );
+
+          std::vector<sender_type*> next;
+          for (size_t index = 0; index < senders.size(); ++index)
+          {
+            if (senders[index]->isDropped())
+              continue;
+
+            switch(results.hand_out(h, index))
+            {
+              case iteration_state::dead:
+              case iteration_state::progress:
+                break;
+
+              case iteration_state::repeat:
+                // All OTHER senders run again, starting behind the repeating one
+                for (size_t other = 1; other < senders.size(); ++other)
+                {
+                  auto sender = senders[(index + other) % senders.size()];
+                  if (not sender->isDropped())
+                    next.push_back(sender);
+                }
+                return next;
+
+              case iteration_state::finish:
+                return next;
+            }
+          }
+
+          return next;
+        }
+    };
+  } // namespace detail
+
+  template <typename R, typename ...Args, typename S, typename H, typename ...A>
+  void parallel_response(thread_pool& pool, message<R(Args...), global_access, S>& message, H&& h, A&& ...args)
+    // Like message.response(args..., h), but the senders marked thread_safe run on the pool.
+    // Every sender runs once per round, handlers dropped in the meantime may still run.
+    // Afterwards h gets the results in delivery order on the calling thread:
+    // dead skips a sender dropped meanwhile, finish discards the remaining results
+    // and repeat discards them too and starts another round with all OTHER senders.
+  {
+    using sender_type = detail::parallel_sender<typename std::remove_reference<decltype(message)>::type>;
+    sender_type::response(pool, message, h, std::forward<A>(args)...);
+  }
+
+  template <typename R, typename ...Args, typename S, typename ...A>
+  void parallel_send(thread_pool& pool, message<R(Args...), global_access, S>& message, A&& ...args)
+  { parallel_response(pool, message, [](...) { }, std::forward<A>(args)...); }
+} // namespace pigeon
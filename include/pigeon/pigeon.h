@@ -31,10 +31,26 @@ Getting started by looking at the pigeon tutorial and the examples.
 Let the pigeons fly.
 */
 
+#pragma once
+
 #include <type_traits>
 #include <utility>
+#include <tuple>
 #include <stdexcept>
 #include <cstdint>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <cstddef>
+#include <cstring>
+
+#ifndef PIGEON_METRICS
+  #define PIGEON_METRICS 0  // 1 counts sends and handler calls per message, see message_metrics
+#endif
+
+#if PIGEON_METRICS
+  #include <mutex>
+#endif
 
 namespace pigeon 
 {
@@ -47,30 +63,92 @@ namespace pigeon
   class  pigeon;
   struct global_access{};
   struct protected_access{};
-  template <typename = void(), typename = global_access> class message;
+  struct list_storage;
+  struct array_storage;
+  template <typename = void(), typename = global_access, typename = list_storage> class message;
+  template <typename> class concurrent_message;
 
   struct allocator
+    // alignment is a power of two, deallocate gets the size and alignment given to allocate
+  {
+    virtual      ~allocator ()                                          = default;
+    virtual void* allocate  (size_t size_bytes, size_t alignment)        = 0;
+    virtual void  deallocate(void*, size_t size_bytes, size_t alignment) = 0;
+  };
+
+  template <typename T>
+  class batch_view
+    // The events of one send_batch, a contiguous range like std::span<T const>
   {
-    virtual      ~allocator ()              = default;
-    virtual void* allocate  (size_t)        = 0;
-    virtual void  deallocate(void*, size_t) = 0;
+    public:
+      batch_view(T const* data, size_t size):Data{data}, Size{size} { }
+
+      template <typename C, typename = decltype(std::declval<C const&>().data())>
+      batch_view(C const& events):batch_view(events.data(), events.size()) { }
+
+      T const* data () const { return Data; }
+      size_t   size () const { return Size; }
+      bool     empty() const { return Size == 0; }
+
+      T const* begin() const { return Data; }
+      T const* end  () const { return Data + Size; }
+
+      T const& operator[](size_t index) const { return Data[index]; }
+
+    private:
+      T const* Data;
+      size_t   Size;
   };
 
-  namespace detail { class contact; }
+  namespace detail { struct contact; class contact_table; template <typename> class parallel_sender; }
   class contact_token
+    // Handed out by pigeon::deliver and passed to onDrop handlers.
+    // Tokens of contacts that are already dropped are detected and ignored,
+    // also after their pigeon is destroyed.
   {
     public:
-      explicit contact_token(detail::contact* ptr):contact(ptr) { }
+      contact_token() = default;
     
     private:
-      detail::contact* contact;
+      contact_token(detail::contact_table* table, std::uint64_t serial, std::uint32_t index, std::uint32_t generation)
+       :Table(table), Serial(serial), Index(index), Generation(generation) { }
+
+      detail::contact_table* Table{nullptr};
+      std::uint64_t          Serial{0};  // tells tables apart that reuse the address of a destroyed one
+      std::uint32_t          Index{0};
+      std::uint32_t          Generation{0};
+
       friend class pigeon;
-      template <typename, typename> friend class message;
+      friend class detail::contact_table;
+      template <typename, typename, typename> friend class message;
+      template <typename> friend class concurrent_message;
   };
 
   namespace detail 
     // Identifiers in namespace detail are not meant for the user and are not part of the API
   {
+    inline size_t padding(const void* pointer, size_t alignment)
+      // bytes to skip from pointer to the next address with the given alignment
+    { return static_cast<size_t>(-reinterpret_cast<std::uintptr_t>(pointer)) & (alignment - 1); }
+
+    inline void* aligned_new(size_t size_bytes, size_t alignment)
+      // operator new only guarantees alignof(std::max_align_t) before C++17, 
+      // the heap pointer is kept in front of the block
+    {
+      auto memory  = static_cast<unsigned char*>(::operator new(size_bytes + alignment + sizeof(void*)));
+      auto pointer = memory + sizeof(void*);
+      pointer += padding(pointer, alignment);
+      std::memcpy(pointer - sizeof(void*), &memory, sizeof(void*));
+      return pointer;
+    }
+
+    inline void aligned_delete(void* pointer)
+    {
+      void* memory;
+      std::memcpy(&memory, static_cast<unsigned char*>(pointer) - sizeof(void*), sizeof(void*));
+      ::operator delete(memory);
+    }
+
     template <typename MR, typename RR> struct call_handler;
       // MR: Message Return type
       // RR: Response handler Return type
@@ -133,65 +211,547 @@ namespace pigeon
     };
 
     struct contact
+      // Four pointers: the vtable, one pointer to each side for dropping in O(1) from the other side,
+      // and the position in the pigeon's table with the priority in the bytes that would be padding.
+    {
+      virtual     ~contact()                      = default;
+      virtual void destruct()                     = 0;
+      virtual void callOnDrop(contact_token, who) = 0;
+      virtual bool detachFromMessage()            = 0;
+        // false while the message is sending, the message reaps the contact on its next visit
+      virtual bool isThreadSafe() const { return false; }
+        // the handler may run on any thread, see parallel.h, a property of the inbox type
+
+      flag_pointer<contact_table> Table;              // nullptr once the pigeon let go, flag stores dropped
+      void*                       Message {nullptr};  // the sender storage, nullptr once the message let go
+      std::uint32_t               Index   {0};        // position in Table
+      std::int16_t                Priority{0};        // higher priorities get the message first
+
+      bool isDropped() const { return Table.test(); }
+      bool drop(who w);
+        // false while the message keeps the contact, because it is sending
+    };
+
+    class contact_table
+      // The contacts of a pigeon, a contact_token is an index with a generation into it.
+      // A released entry gets a new generation before it is reused, 
+      // so drop is O(1) and stale tokens are detected without touching the contact.
+      // Tables are recycled and never freed, so a token can always look into its table in O(1),
+      // even after its pigeon is destroyed. Every use of a table gets a new serial, 
+      // a recycled table does not take the tokens of its previous pigeon.
+    {
+      public:
+        contact_table(contact_table const&) = delete;
+
+        static contact_table* acquire()
+        {
+          auto& pool = recycled();
+          {
+            std::lock_guard<std::mutex> lock{pool.Mutex};
+            if (auto table = pool.Tables)
+            {
+              pool.Tables   = table->NextRecycled;
+              table->Serial = next_serial();
+              return table;
+            }
+          }
+          return new contact_table;
+        }
+
+        static void recycle(contact_table* table)
+        {
+          delete[] table->Entries;
+          table->Entries  = nullptr;
+          table->Size     = 0;
+          table->Capacity = 0;
+          table->FreeHead = npos;
+          table->Live     = 0;
+
+          auto& pool = recycled();
+          std::lock_guard<std::mutex> lock{pool.Mutex};
+          table->Serial       = 0;  // no token has serial 0
+          table->NextRecycled = pool.Tables;
+          pool.Tables         = table;
+        }
+
+        size_t size() const { return Live; }
+
+        void reserve()
+          // Make room for one more contact, so insert can not throw
+        {
+          if ((FreeHead == npos or Clearing) and Size == Capacity)
+            grow();
+        }
+
+        contact_token insert(contact* c)
+        {
+          std::uint32_t index;
+          if (FreeHead != npos and not Clearing)
+          {
+            index    = FreeHead;
+            FreeHead = Entries[index].NextFree;
+          }
+          else
+          {
+            reserve();
+            index = Size++;
+          }
+
+          Entries[index].Contact = c;
+          c->Table.keep_flag_assign_pointer(this);
+          c->Index = index;
+          ++Live;
+          return token(index);
+        }
+
+        contact* find(contact_token const& t) const
+        {
+          if (t.Table != this or t.Serial != Serial or t.Index >= Size)
+            return nullptr;
+
+          auto& entry = Entries[t.Index];
+          return entry.Generation == t.Generation ? entry.Contact : nullptr;
+        }
+
+        contact_token token(std::uint32_t index) const
+        { return {const_cast<contact_table*>(this), Serial, index, Entries[index].Generation}; }
+
+        void release(std::uint32_t index)
+        {
+          auto& entry = Entries[index];
+          entry.Contact  = nullptr;
+          entry.NextFree = FreeHead;
+          ++entry.Generation;
+          FreeHead = index;
+          --Live;
+        }
+
+        bool clear()
+          // false if a sending message keeps one of the contacts
+        {
+          // Entries are not reused while clearing, 
+          // so contacts delivered by onDrop handlers meanwhile are kept
+          auto clearing = Clearing;
+          Clearing = true;
+
+          auto detached = true;
+          auto size     = Size;
+          for (std::uint32_t index = 0; index < size; ++index)
+            if (auto contact = Entries[index].Contact)
+              detached = contact->drop(who::pigeon) and detached;
+
+          Clearing = clearing;
+          return detached;
+        }
+
+      private:
+        static const std::uint32_t npos = ~std::uint32_t{0};
+
+        struct entry
+        {
+          contact*      Contact;
+          std::uint32_t Generation;
+          std::uint32_t NextFree;
+        };
+
+        std::uint64_t  Serial      {next_serial()};
+        contact_table* NextRecycled{nullptr};
+        entry*         Entries     {nullptr};
+        std::uint32_t Size    {0};
+        std::uint32_t Capacity{0};
+        std::uint32_t FreeHead{npos};
+        bool          Clearing{false};
+        size_t        Live    {0};
+
+        contact_table() = default;
+
+        static std::uint64_t next_serial()
+        {
+          static std::atomic<std::uint64_t> Serials{0};
+          return ++Serials;
+        }
+
+        struct pool
+        {
+          std::mutex     Mutex;
+          contact_table* Tables{nullptr};
+        };
+
+        static pool& recycled()
+        {
+          static pool Pool;
+          return Pool;
+        }
+
+        void grow()
+        {
+          auto capacity = Capacity ? 2 * Capacity : 4;
+          auto entries  = new entry[capacity];
+          for (std::uint32_t index = 0; index < Size; ++index)
+            entries[index] = Entries[index];
+
+          for (auto index = Size; index < capacity; ++index)
+            entries[index] = entry{nullptr, 0, npos};
+
+          delete[] Entries;
+          Entries  = entries;
+          Capacity = capacity;
+        }
+    };
+
+    inline bool contact::drop(who w)
+      // Called by the side letting go, the contact leaves the other side at once 
+      // and is destructed, unless its message is sending right now
     {
-      virtual     ~contact()       = default;
-      virtual void destruct()      = 0;
-      virtual void callOnDrop(who) = 0;
+      auto first = not isDropped();
+      Table.set();
 
-      flag_pointer<contact> NextContact;  // flag stores dropped
+      contact_token token;
+      if (auto table = Table.get())
+      {
+        token = table->token(Index);
+        table->release(Index);
+        Table.keep_flag_assign_pointer(nullptr);
+      }
+
+      auto detached = detachFromMessage();
+
+      if (first)
+        callOnDrop(token, w);
+
+      if (detached)
+        destruct();
+      return detached;
+    }
+
+    template <typename S>
+    class sender_storage
+      // The message side of a sender, lets a sender leave its message when the pigeon drops it
+    {
+      public:
+        virtual bool detach(S*) = 0;
+          // Unlinks the sender, returns false while the message is sending
+
+        bool owns(contact const* c) const 
+        { return c and c->Message == static_cast<void const*>(this); }
 
-      bool isDropped () const { return NextContact.test(); }
-      void setDropped(who w)  { NextContact.set(); callOnDrop(w); }
-      void drop      (who w)  { if (isDropped()) destruct(); else setDropped(w); }
+        template <typename T>
+        allocator* inline_allocator() { return nullptr; }
+          // Memory for a sender of type T inside the storage itself, nullptr if there is none
+
+      protected:
+        ~sender_storage() = default;
+        void* self() { return static_cast<void*>(this); }
     };
 
+    template <typename A>
+    using pass_type = A&&;
+      // How an argument is handed through to a handler, as an rvalue like std::forward
+
+    template <typename A>
+    pass_type<A> pass(typename std::remove_reference<A>::type& a) { return static_cast<pass_type<A>>(a); }
+
+    template <typename A>
+    struct hand_over
+      // Every handler gets its own copy of an argument taken by value, 
+      // so it can not see the changes or the moved from leftovers of the handler before.
+      // The value itself is moved only when there is exactly one handler to get it, 
+      // with more handlers each of them gets a copy.
+    {
+      static A of(A& a, bool only) { return of(a, only, std::is_copy_constructible<A>{}); }
+
+      static A of(A& a, bool only, std::true_type) { return only ? A(std::move(a)) : A(a); }
+      static A of(A& a, bool,      std::false_type /* move only */) { return A(std::move(a)); }
+    };
+
+    template <typename A>
+    struct hand_over<A&> { static A& of(A& a, bool) { return a; } };
+
+    template <typename A>
+    struct hand_over<A&&> { static A&& of(A& a, bool) { return std::move(a); } };
+
+    template <size_t ...I> struct indices { };
+    template <size_t N, size_t ...I> struct make_indices: make_indices<N - 1, N - 1, I...> { };
+    template <size_t ...I> struct make_indices<0, I...> { using type = indices<I...>; };
+
+    template <typename A>
+    struct deferred_arg
+      // Arguments taken by value move into the queue and out of it again
+    {
+      using type = A;
+      static type   store(A& a)    { return std::move(a); }
+      static type&& load (type& a) { return std::move(a); }
+    };
+
+    template <typename A>
+    struct deferred_arg<A const&>
+      // The sender's object is gone at replay, the queue keeps a copy
+    {
+      using type = typename std::decay<A>::type;
+      static type        store(A const& a) { return a; }
+      static type const& load (type& a)    { return a; }
+    };
+
+    template <typename A>
+    struct deferred_arg<A&>
+      // The object handlers change stays a reference and has to outlive the outermost send
+    {
+      using type = A*;
+      static type store(A& a)    { return &a; }
+      static A&   load (type& a) { return *a; }
+    };
+
+    template <>
+    struct deferred_arg<value_state&>
+      // The sender does not wait for the state, it starts over
+    {
+      using type = value_state;
+      static type         store(value_state&) { return value_state::original; }
+      static value_state& load (type& a)      { return a; }
+    };
+
+    template <typename A>
+    struct deferred_arg<A&&>
+    {
+      using type = A;
+      static type store(A& a)    { return std::move(a); }
+      static A&&  load (type& a) { return std::move(a); }
+    };
+
+    template <size_t N, typename ...Args>
+    class deferred_queue
+      // A ring inside the message for N sends that come in while sending,
+      // the outermost send replays them in order after its own iteration
+    {
+      public:
+        deferred_queue() = default;
+        deferred_queue(deferred_queue const&) { }  // a copy starts without deferred sends
+        deferred_queue& operator=(deferred_queue const&) { return *this; }
+       ~deferred_queue() { discard(); }
+
+      protected:
+        struct discard_guard
+          // Deferred sends left over when a handler throws go away
+        {
+          deferred_queue* Queue;
+         ~discard_guard() { if (Queue) Queue->discard(); }
+        };
+
+        discard_guard outermost() { return {Replaying ? nullptr : this}; }
+
+        bool defer(typename std::remove_reference<Args>::type& ...args)
+        {
+          if (Count == N)
+            throw std::logic_error("Logic error, too many deferred sends");
+
+          new (slot(Count)) entry{deferred_arg<Args>::store(args)...};
+          ++Count;
+          return true;
+        }
+
+        template <typename F>
+        void replay(F&& f)
+          // Sends from f are outermost sends, they defer to this loop instead of replaying themselves
+        {
+          if (Replaying or Count == 0)
+            return;
+
+          struct replaying_guard { bool& Flag; ~replaying_guard() { Flag = false; } } guard{Replaying};
+          Replaying = true;
+          while (Count != 0)
+          {
+            entry deferred{std::move(*slot(0))};
+            pop();
+            call(f, deferred, typename make_indices<sizeof...(Args)>::type{});
+          }
+        }
+
+      private:
+        using entry = std::tuple<typename deferred_arg<Args>::type...>;
+
+        template <typename F, size_t ...I>
+        static void call(F& f, entry& deferred, indices<I...>)
+        { f(deferred_arg<Args>::load(std::get<I>(deferred))...); }
+
+        entry* slot(size_t k) { return reinterpret_cast<entry*>(Slots[(Head + k) % N]); }
+
+        void pop()
+        {
+          slot(0)->~entry();
+          Head = (Head + 1) % N;
+          --Count;
+        }
+
+        void discard()
+        {
+          while (Count != 0)
+            pop();
+        }
+
+        alignas(entry) unsigned char Slots[N][sizeof (entry)];
+        size_t Head{0};
+        size_t Count{0};
+        bool   Replaying{false};
+    };
+
+    template <typename ...Args>
+    class deferred_queue<0, Args...>
+      // Reentrant sends are ignored, nothing to keep
+    {
+      protected:
+        struct discard_guard { ~discard_guard() { } };
+
+        discard_guard outermost() { return {}; }
+        bool defer(typename std::remove_reference<Args>::type& ...) { return false; }
+        template <typename F> void replay(F&&) { }
+    };
+
+    struct no_batch { };
+    template <typename R, typename ...Args> struct batch_element    { using type = no_batch; };
+    template <typename A>                   struct batch_element<void, A> 
+    { using type = typename std::conditional<std::is_copy_constructible<A>::value, A, no_batch>::type; };
+    template <typename A>                   struct batch_element<void, A const&> { using type = A; };
+      // Only messages with one copyable argument and without return value send batches,
+      // a handler taking the argument as rvalue gets its own copy of each event
+
     template <typename R, typename ...Args>
     struct sender: contact
     {
+      using send_type  = R (*)(sender*, pass_type<Args>...);
+      using batch_type = typename batch_element<R, Args...>::type;
+
+      virtual void send_batch(batch_view<batch_type>) = 0;
+        // One virtual call per batch, the inbox loops over the events if its handler takes one at a time
+
+      explicit sender(send_type send):Send{send} { }
+
       flag_pointer<sender> NextSender{nullptr};
         // We need NextSender to have the same type as Message::Senders
         // The flag is unused here
+        // Together with PreviousLink, Send and the four pointers of the contact a sender takes seven pointers
 
-      virtual R send(Args ...args) = 0; 
+      union
+      {
+        flag_pointer<sender>* PreviousLink;  // sender_list: the link pointing to this sender
+        size_t                Slot;          // sender_array: the index of this sender
+      };
+
+      send_type Send;
+        // Plain function pointer instead of a virtual function, 
+        // saves the vtable lookup on every send
+
+      bool detachFromMessage() override
+      { return not Message or static_cast<sender_storage<sender>*>(Message)->detach(this); }
 
       template <typename MR, typename H>
       typename std::enable_if<std::is_same<MR, void>::value, iteration_state>::type
         // Case where Message Handler has return type void
-      do_send(H& h, Args ...args) 
+      do_send(H& h, pass_type<Args> ...args) 
       { 
-        send(std::forward<Args>(args)...); 
+        Send(this, pass<Args>(args)...); 
         return call_handler<void, decltype(h())>::call(h); 
       }
 
       template <typename MR, typename H>
       typename std::enable_if<!std::is_same<MR, void>::value, iteration_state>::type
         // Case where Message Handler has not return type void
-      do_send(H& h, Args ...args) 
+      do_send(H& h, pass_type<Args> ...args) 
       { 
         return detail::call_handler<MR, decltype(h(std::declval<MR>()))>::
-          call(h, send(std::forward<Args>(args)...)); 
+          call(h, Send(this, pass<Args>(args)...)); 
       }
 
       template <typename H>
-      iteration_state try_send(H& h, Args ...args)
+      iteration_state try_send(H& h, pass_type<Args> ...args)
       {
         if (isDropped())
           return iteration_state::dead;
         else
-          return do_send<R>(h, std::forward<Args>(args)...);
+          return do_send<R>(h, pass<Args>(args)...);
       }
     };
 
+    template <typename H>
+    struct thread_safe_handler: H
+      // Marks a handler that may run on any thread, see pigeon::thread_safe in parallel.h
+    {
+      template <typename I>
+      explicit thread_safe_handler(I&& handler):H(std::forward<I>(handler)) { }
+
+      using H::operator();
+    };
+
+    template <typename H> struct is_thread_safe                        : std::false_type { };
+    template <typename H> struct is_thread_safe<thread_safe_handler<H>>: std::true_type  { };
+
+    template <typename H>
+    struct batch_handler: H
+      // Marks a handler taking a whole batch_view, see pigeon::batch
+    {
+      template <typename I>
+      explicit batch_handler(I&& handler):H(std::forward<I>(handler)) { }
+
+      using H::operator();
+    };
+
+    template <typename H> struct is_batch                        : std::false_type { };
+    template <typename H> struct is_batch<batch_handler<H>>      : std::true_type  { };
+    template <typename H> struct is_batch<thread_safe_handler<H>>: is_batch<H>     { };
+
+    template <bool IsBatch> struct batch_call
+      // Handler taking one event at a time
+    {
+      template <typename H>
+      static void batch(H&, batch_view<no_batch>) { }
+
+      template <typename H, typename T>
+      static void batch(H& h, batch_view<T> events) 
+      { 
+        for (auto& event: events) 
+          one(h, event, 0); 
+      }
+
+      template <typename H, typename T>
+      static auto one(H& h, T const& event, int) -> decltype(h(event)) { return h(event); }
+
+      template <typename H, typename T>
+      static void one(H& h, T const& event, long)
+        // The handler takes an rvalue, it gets its own copy like with send
+      { h(T(event)); }
+    };
+
+    template <> struct batch_call<true>
+      // Handler taking a batch_view
+    {
+      template <typename H, typename T>
+      static void batch(H& h, batch_view<T> events) { h(events); }
+    };
+
     template <typename H, typename F, typename R, typename ...Args>
     struct inbox: H, F, sender<R, Args...>
       // Derive from H to enable empty base class optimization if possible
     {
       template <typename I, typename J>
-      inbox(I&& box, J&& drop):H{std::forward<I>(box)}, F{std::forward<J>(drop)} { }
-      R send(Args ...args) override { return H::operator()(std::forward<Args>(args)...); }
+      inbox(I&& box, J&& drop)
+       :H{std::forward<I>(box)}, F{std::forward<J>(drop)}, sender<R, Args...>{&inbox::send} 
+      { }
+
+      static R send(sender<R, Args...>* self, pass_type<Args> ...args) 
+      { return send(self, is_batch<H>{}, pass<Args>(args)...); }
+
+      static R send(sender<R, Args...>* self, std::false_type /* one event at a time */, pass_type<Args> ...args) 
+      { return static_cast<inbox*>(self)->H::operator()(pass<Args>(args)...); }
+
+      template <typename A>
+      static void send(sender<R, Args...>* self, std::true_type /* batch handler */, A&& event) 
+      { static_cast<inbox*>(self)->H::operator()(batch_view<typename std::decay<A>::type>{&event, 1}); }
+
+      void send_batch(batch_view<typename sender<R, Args...>::batch_type> events) override
+      { batch_call<is_batch<H>::value>::batch(static_cast<H&>(*this), events); }
 
       void destruct() override { delete this; }
-      void callOnDrop(who w) override { F::operator()(contact_token{this}, w); }
+      void callOnDrop(contact_token token, who w) override { F::operator()(token, w); }
+      bool isThreadSafe() const override { return is_thread_safe<H>::value; }
     };
 
     template <typename H, typename F, typename R, typename ...Args>
@@ -199,61 +759,993 @@ namespace pigeon
     {
       allocator* Alloc;
 
-      template <typename I, typename J>
-      inbox_with_allocator(I&& box, allocator* alloc, J&& drop)
-       :inbox<H, F, R, Args...>{std::forward<I>(box), std::forward<J>(drop)},
-        Alloc{alloc}
-      { }
+      template <typename I, typename J>
+      inbox_with_allocator(I&& box, allocator* alloc, J&& drop)
+       :inbox<H, F, R, Args...>{std::forward<I>(box), std::forward<J>(drop)},
+        Alloc{alloc}
+      { }
+
+      void destruct() override
+      { 
+        auto alloc = Alloc;
+        this->~inbox_with_allocator();
+        alloc->deallocate(this, sizeof (inbox_with_allocator), alignof(inbox_with_allocator)); 
+      }
+    };
+
+    template <typename P> struct policy { };
+      // Tag for the stateless allocation policy P of a basic_pigeon
+
+    template <typename P, typename H, typename F, typename R, typename ...Args>
+    struct inbox_with_policy: public inbox<H, F, R, Args...>
+      // Knows its allocation policy from its type, no allocator pointer needed
+    {
+      template <typename I, typename J>
+      inbox_with_policy(I&& box, J&& drop)
+       :inbox<H, F, R, Args...>{std::forward<I>(box), std::forward<J>(drop)}
+      { }
+
+      void destruct() override
+      { 
+        this->~inbox_with_policy();
+        P::deallocate(this, sizeof (inbox_with_policy), alignof(inbox_with_policy)); 
+      }
+    };
+
+    class slot_pool: public allocator
+      // Recycles fixed size slots for small inboxes, so most deliver calls do not go to the heap.
+      // A slot fits the inbox of a handler capturing a few pointers, 
+      // e.g. a lambda capturing this or a member function handler.
+      // Every thread allocates from its own pool, the inbox remembers the pool of its slot.
+      // A slot released on another thread, e.g. a contact dropped from a parallel_send worker 
+      // or a pigeon moved to another thread, goes to the pool's remote list, 
+      // the owning thread takes those slots back once its own free list runs empty.
+    {
+      public:
+        static const size_t SlotSize      = 12 * sizeof(void*);
+          // Twelve pointers: a sender is seven, the allocator pointer of its inbox one,
+          // a member function handler three, rounded up to keep every slot max aligned
+        static const size_t SlotsPerChunk = 64;
+        static_assert(SlotSize % alignof(std::max_align_t) == 0, 
+                      "SlotSize must be a multiple of alignof(std::max_align_t), so every slot stays aligned");
+
+        template <typename T> struct fits
+        {
+          static const bool value = (sizeof (T) <= SlotSize) and 
+                                    (alignof(T) <= alignof(std::max_align_t));
+        };
+
+        static slot_pool& local()
+        {
+          struct holder
+          {
+            slot_pool* Pool{current() = new slot_pool};
+           ~holder() { current() = nullptr; Pool->orphan(); }
+          };
+
+          static thread_local holder Holder;
+          return *Holder.Pool;
+        }
+
+        void* allocate(size_t, size_t) override
+          // only used for inboxes that fit
+        {
+          assert(this == current() && "a slot_pool allocates only on its own thread");
+
+          if (not FreeSlots)
+            FreeSlots = Remote.exchange(nullptr, std::memory_order_acquire);
+          if (not FreeSlots)
+            grow();
+
+          auto slot = FreeSlots;
+          FreeSlots = FreeSlots->Next;
+          ++Used;
+          return slot;
+        }
+
+        void deallocate(void* pointer, size_t, size_t) override
+        {
+          auto slot = static_cast<free_slot*>(pointer);
+          if (this == current())
+          {
+            slot->Next = FreeSlots;
+            FreeSlots = slot;
+            --Used;
+            return;
+          }
+
+          slot->Next = Remote.load(std::memory_order_relaxed);
+          while (not Remote.compare_exchange_weak(slot->Next, slot, std::memory_order_release, std::memory_order_relaxed))
+            ;
+
+          auto previous = State.fetch_add(2, std::memory_order_acq_rel);
+          if ((previous & 1) and (previous >> 1) + 1 == Limit)
+            delete this;
+        }
+
+        size_t used  () const { return Used - (State.load(std::memory_order_acquire) >> 1); }
+        size_t chunks() const { return Chunks; }
+
+      private:
+        struct free_slot { free_slot* Next; };
+        struct chunk     { chunk* Next; };
+          // The chunk header takes the space of one slot, to keep the slots aligned
+
+        free_slot*              FreeSlots{nullptr};
+        std::atomic<free_slot*> Remote   {nullptr};  // slots released on other threads
+        chunk*                  Memory   {nullptr};
+        size_t                  Used     {0};        // allocated minus released on the owning thread
+        size_t                  Chunks   {0};
+        size_t                  Limit    {0};        // Used when the owning thread ended
+        std::atomic<size_t>     State    {0};
+          // Twice the number of slots released on other threads, 
+          // the lowest bit is set once the owning thread has ended
+
+        static slot_pool*& current()
+          // The pool of the calling thread, nullptr after the thread let go of it
+        {
+          static thread_local slot_pool* Current{nullptr};
+          return Current;
+        }
+
+        slot_pool() = default;
+       ~slot_pool()
+        {
+          while(Memory)
+          {
+            auto next = Memory->Next;
+            delete[] reinterpret_cast<unsigned char*>(Memory);
+            Memory = next;
+          }
+        }
+
+        void orphan()
+        {
+          // Slots still in use keep the pool alive after its thread ended, 
+          // e.g. contacts of static messages, the last release deletes it
+          Limit = Used;
+          if ((State.fetch_or(1, std::memory_order_acq_rel) >> 1) == Limit)
+            delete this;
+        }
+
+        void grow()
+        {
+          auto memory = new unsigned char[(SlotsPerChunk + 1) * SlotSize];
+          auto header = reinterpret_cast<chunk*>(memory);
+          header->Next = Memory;
+          Memory = header;
+          ++Chunks;
+
+          for (auto index = SlotsPerChunk; index; --index)
+          {
+            auto slot = reinterpret_cast<free_slot*>(memory + index * SlotSize);
+            slot->Next = FreeSlots;
+            FreeSlots = slot;
+          }
+        }
+    };
+
+    struct aligned_heap: allocator
+      // For over-aligned inboxes delivered without an allocator
+    {
+      static aligned_heap& instance()
+      {
+        static aligned_heap Heap;
+        return Heap;
+      }
+
+      void* allocate  (size_t size_bytes, size_t alignment) override { return aligned_new(size_bytes, alignment); }
+      void  deallocate(void* pointer, size_t, size_t)        override { aligned_delete(pointer); }
+    };
+
+    struct noop { void operator()(contact_token, who) { } };
+
+    template <typename R, typename F>
+    struct handler
+    {
+      R* self;
+      F f;
+
+      template <typename ...Args>
+      auto operator()(Args&& ...args)
+        -> decltype((self->*f)(std::forward<Args>(args)...))
+      { return (self->*f)(std::forward<Args>(args)...); }
+    };
+
+    template <typename ...Args> struct argument_checker;
+
+    template <> struct argument_checker<> 
+    { static const bool value = true; };
+
+    template <typename Arg, typename ...Args>
+    struct argument_checker<Arg, value_state&, Args...>: argument_checker<Args...> { };
+
+    template <typename Arg, typename ...Args>
+    struct argument_checker<Arg, Args...>: argument_checker<Args...>
+    { 
+      static_assert(!std::is_rvalue_reference<Arg>::value, 
+        "RValue reference not allowed as arguments without a "
+        "following associated pigeon::value_state& argument"
+      ); 
+
+      static_assert(!std::is_lvalue_reference<Arg>::value ||
+        std::is_const<typename std::remove_reference<Arg>::type>::value, 
+        "LValue reference must be const or followed by "
+        "an associated pigeon::value_state& argument"
+      ); 
+    };
+
+    inline void prefetch(void const* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(address);
+#else
+      (void)address;
+#endif
+    }
+
+    template <typename S>
+    class sender_list: public sender_storage<S>
+      // Intrusive doubly linked list, the default storage of pigeon::message
+      // Every sender knows the link pointing to it, so it leaves the list in O(1)
+    {
+      public:
+        sender_list() = default;
+        sender_list(sender_list const&):sender_list() { }  // a copy starts without senders
+
+        bool isSending() const { return Senders.test(); }
+
+        size_t size() const { return Live; }
+
+        void push(S* sender)
+        {
+          // Messages get delivered in order of priority, higher priorities first.
+          // Within a priority in reverse order of deliver calls 
+          // which might be counter intuitive, but I do not guarantee
+          // any order and even change it with iteration_state::repeat.
+          // Inserting is O(1), unless senders with higher priority have to be skipped.
+          auto position = &Senders;
+          while (position->get() and position->get()->Priority > sender->Priority)
+            position = &position->get()->NextSender;
+
+          sender->Message = this->self();
+          link(*position, sender);
+          ++Live;
+        }
+
+        void clear()
+        {
+          // Move the senders aside first, onDrop handlers may deliver to this message again
+          sender_list detached;
+          auto sender = Senders.get();
+          Senders.keep_flag_assign_pointer(nullptr);
+          detached.Senders.keep_flag_assign_pointer(sender);
+          if (sender)
+            sender->PreviousLink = &detached.Senders;
+
+          for (; sender; sender = sender->NextSender.get())
+            sender->Message = detached.self();
+
+          detached.Live    = Live;
+          detached.Pending = Pending;
+          Live = Pending = 0;
+
+          while(auto first = detached.Senders.get())
+            detached.erase(first);
+        }
+
+        void erase(S* sender)
+        {
+          sender->isDropped() ? --Pending : --Live;
+          unlink(sender);
+          sender->drop(who::message);
+        }
+
+        bool detach(S* sender) override
+        {
+          --Live;
+          if (isSending())
+          {
+            ++Pending;
+            return false;
+          }
+
+          unlink(sender);
+          return true;
+        }
+
+        template <typename V>
+        void iterate(V&& visit)
+        {
+          if (visit_senders(visit))
+            restore_priority_order();
+
+          reap();
+        }
+
+        template <typename F>
+        void hold(F&& f)
+          // Calls f while marked as sending, so drops meanwhile are deferred
+        {
+          {
+            auto guard = Senders.scoped_set();
+            f();
+          }
+          reap();
+        }
+
+        template <typename V>
+        void for_each(V&& visit) const
+          // Visits the senders in delivery order, without marking as sending
+        {
+          for (auto sender = Senders.get(); sender; sender = sender->NextSender.get())
+            visit(*sender);
+        }
+
+      private:
+        flag_pointer<S> Senders;     // flag stores isSending
+        std::uint32_t   Live   {0};  // senders not dropped
+        std::uint32_t   Pending{0};  // senders dropped while sending, but not yet reaped
+
+        void reap()
+          // Reap the senders dropped while sending, that were already visited
+        {
+          if (Pending)
+            for (auto sender = Senders.get(); sender; )
+            {
+              auto next = sender->NextSender.get();
+              if (sender->isDropped())
+                erase(sender);
+
+              sender = next;
+            }
+        }
+
+        template <typename V>
+        bool visit_senders(V& visit)
+          // Returns if a repeat rotated the senders
+        {
+          // set isSending true here in exception safe RAII fashion
+          auto guard = Senders.scoped_set();
+
+          bool rotated{false};
+          auto sender = Senders.get();
+          S* previousSender{nullptr};  // the linked sender in front of sender
+          S* lastSender    {nullptr};  // found on the first repeat, maintained afterwards
+          while(sender)
+          {
+            switch(visit(*sender))
+            {
+              case iteration_state::dead:
+              {
+                auto next = sender->NextSender.get();
+                if (sender == lastSender)
+                  lastSender = previousSender;
+
+                erase(sender);
+                sender = next;
+                break;
+              }
+
+              case iteration_state::progress:
+                previousSender = sender;
+                sender = sender->NextSender.get();
+                break;
+
+              case iteration_state::repeat:
+              {
+                // Do not change the order of these steps without intense scrutiny
+                // Modify linked list so we will repeat the OTHER senders, but
+                // not the active sender
+                auto firstSender = Senders.get();
+                if (sender != firstSender)
+                {
+                  // find lastSender, only once per iteration
+                  if (not lastSender)
+                  {
+                    lastSender = sender;
+                    while(lastSender->NextSender)
+                      lastSender = lastSender->NextSender.get();
+                  }
+
+                  // unlink sender and make new list end 
+                  sender->PreviousLink->keep_flag_assign_pointer(nullptr);
+
+                  // splice
+                  lastSender->NextSender.keep_flag_assign_pointer(firstSender);
+                  firstSender->PreviousLink = &lastSender->NextSender;
+                  Senders.keep_flag_assign_pointer(sender);
+                  sender->PreviousLink = &Senders;
+
+                  // the sender in front of the active sender is the new list end
+                  lastSender = previousSender;
+                  rotated = true;
+                }
+
+                // next
+                previousSender = sender;
+                sender = sender->NextSender.get();
+                break;
+              }
+
+              case iteration_state::finish:
+                return rotated;
+            }
+          }
+          return rotated;
+        }
+
+        void restore_priority_order()
+          // The senders are a rotation of the priority order, 
+          // rotate back so the highest priority comes first again
+        {
+          S* ascent{nullptr};  // followed by a higher priority
+          S* lastSender{nullptr};
+          for (auto sender = Senders.get(); sender; sender = sender->NextSender.get())
+          {
+            auto next = sender->NextSender.get();
+            if (next and next->Priority > sender->Priority)
+              ascent = sender;
+
+            lastSender = sender;
+          }
+
+          if (not ascent)
+            return;
+
+          auto firstSender = Senders.get();
+          auto head        = ascent->NextSender.get();
+          ascent->NextSender.keep_flag_assign_pointer(nullptr);
+          lastSender->NextSender.keep_flag_assign_pointer(firstSender);
+          firstSender->PreviousLink = &lastSender->NextSender;
+          Senders.keep_flag_assign_pointer(head);
+          head->PreviousLink = &Senders;
+        }
+
+        static void link(flag_pointer<S>& link, S* sender)
+          // insert sender in front of the sender link points to
+        {
+          auto next = link.get();
+          sender->NextSender.keep_flag_assign_pointer(next);
+          if (next)
+            next->PreviousLink = &sender->NextSender;
+
+          link.keep_flag_assign_pointer(sender);
+          sender->PreviousLink = &link;
+        }
+
+        static void unlink(S* sender)
+        {
+          auto next = sender->NextSender.get();
+          sender->PreviousLink->keep_flag_assign_pointer(next);
+          if (next)
+            next->PreviousLink = sender->PreviousLink;
+
+          sender->Message = nullptr;
+        }
+    };
+
+    template <typename S>
+    class sender_array: public sender_storage<S>
+      // Contiguous array of sender pointers, so iterating over many senders streams 
+      // through memory instead of chasing one pointer per sender.
+      // The senders are stored in reverse delivery order, so deliver is a cheap push_back
+      // and the delivery order is the same as with sender_list.
+      // A sender leaving the array leaves a hole (nullptr) that gets compacted later.
+      // A repeat only moves the Split, the array gets rotated on the next deliver.
+    {
+      public:
+        sender_array() = default;
+        sender_array(sender_array const&):sender_array() { }  // a copy starts without senders
+       ~sender_array() { delete[] Senders.get(); }
+
+        bool isSending() const { return Senders.test(); }
+
+        size_t size() const { return Live; }
+
+        void push(S* sender)
+        {
+          if (Split)
+            rotate(Split);
+
+          if (Size == Capacity and Holes)
+            compact();
+
+          if (Size == Capacity)
+            grow();
+
+          // Skip the senders with higher priority from the top, usually none
+          auto senders = Senders.get();
+          auto index   = Size;
+          while (index and (not senders[index - 1] or senders[index - 1]->Priority > sender->Priority))
+            --index;
+
+          for (auto slot = Size; slot > index; --slot)
+          {
+            senders[slot] = senders[slot - 1];
+            if (senders[slot])
+              senders[slot]->Slot = slot;
+          }
+
+          sender->Message = this->self();
+          sender->Slot    = index;
+          senders[index]  = sender;
+          ++Size;
+          ++Live;
+        }
+
+        void clear()
+        {
+          // Move the senders aside first, onDrop handlers may deliver to this message again
+          sender_array detached;
+          swap(detached);
+          for (size_t index = 0; index < detached.Size; ++index)
+            if (auto sender = detached.Senders.get()[index])
+              sender->Message = detached.self();
+
+          while(detached.Size)
+            if (auto sender = detached.Senders.get()[detached.Size - 1])
+              detached.erase(sender);
+            else
+              --detached.Size;
+        }
+
+        void erase(S* sender)
+        {
+          sender->isDropped() ? --Pending : --Live;
+          unlink(sender);
+          sender->drop(who::message);
+        }
+
+        bool detach(S* sender) override
+        {
+          --Live;
+          if (isSending())
+          {
+            ++Pending;
+            return false;
+          }
+
+          unlink(sender);
+          return true;
+        }
+
+        template <typename V>
+        void iterate(V&& visit)
+        {
+          if (visit_senders(visit))
+            restore_priority_order();
+
+          reap();
+        }
+
+        template <typename F>
+        void hold(F&& f)
+          // Calls f while marked as sending, so drops meanwhile are deferred
+        {
+          {
+            auto guard = Senders.scoped_set();
+            f();
+          }
+          reap();
+        }
+
+        template <typename V>
+        void for_each(V&& visit) const
+          // Visits the senders in delivery order, without marking as sending
+        {
+          auto senders = Senders.get();
+          auto index   = Split;
+          for (auto count = Size; count--; )
+          {
+            index = (index ? index : Size) - 1;
+            if (senders[index])
+              visit(*senders[index]);
+          }
+        }
+
+      private:
+        flag_pointer<S*> Senders;     // flag stores isSending
+        size_t           Size    {0};
+        size_t           Capacity{0};
+        size_t           Holes   {0};
+        size_t           Split   {0};  // senders[0, Split) are delivered before senders[Split, Size)
+        std::uint32_t    Live    {0};  // senders not dropped
+        std::uint32_t    Pending {0};  // senders dropped while sending, but not yet reaped
+
+        void reap()
+          // Reap the senders dropped while sending, that were already visited
+        {
+          if (Pending)
+            for (size_t index = 0; index < Size; ++index)
+            {
+              auto sender = Senders.get()[index];
+              if (sender and sender->isDropped())
+                erase(sender);
+            }
+
+          if (Holes)
+            compact();
+        }
+
+        template <typename V>
+        bool visit_senders(V& visit)
+          // Returns if a repeat rotated the senders
+        {
+          // set isSending true here in exception safe RAII fashion
+          // deliver, drop and clear are not allowed while sending, so the array stays put
+          auto guard   = Senders.scoped_set();
+          auto senders = Senders.get();
+
+          bool rotated{false};
+          auto count = Size;
+          auto index = Split;
+          while(count--)
+          {
+            index = (index ? index : Size) - 1;
+            auto sender = senders[index];
+            if (not sender)
+              continue;
+
+            prefetch(senders[(index ? index : Size) - 1]);
+
+            switch(visit(*sender))
+            {
+              case iteration_state::dead:
+                erase(sender);
+                break;
+
+              case iteration_state::progress:
+                break;
+
+              case iteration_state::repeat:
+                // The active sender becomes the first one delivered 
+                // and all OTHER senders get repeated, same as with sender_list
+                rotated = rotated or (Split != index + 1);
+                Split   = index + 1;
+                count   = Size - 1;
+                break;
+
+              case iteration_state::finish:
+                count = 0;
+                break;
+            }
+          }
+          return rotated;
+        }
+
+        void restore_priority_order()
+          // The senders are a rotation of the priority order, 
+          // move the Split so the highest priority comes first again
+        {
+          auto senders = Senders.get();
+          S* previous{nullptr};
+          auto index = Split;
+          for (auto count = Size; count--; )
+          {
+            index = (index ? index : Size) - 1;
+            if (auto sender = senders[index])
+            {
+              if (previous and sender->Priority > previous->Priority)
+              {
+                Split = index + 1;
+                return;
+              }
+              previous = sender;
+            }
+          }
+        }
+
+        void unlink(S* sender)
+        {
+          Senders.get()[sender->Slot] = nullptr;
+          sender->Message = nullptr;
+          ++Holes;
+        }
+
+        void swap(sender_array& other)
+        {
+          auto senders = Senders.get();
+          Senders.keep_flag_assign_pointer(other.Senders.get());
+          other.Senders.keep_flag_assign_pointer(senders);
+
+          std::swap(Size    , other.Size);
+          std::swap(Capacity, other.Capacity);
+          std::swap(Holes   , other.Holes);
+          std::swap(Split   , other.Split);
+          std::swap(Live    , other.Live);
+          std::swap(Pending , other.Pending);
+        }
+
+        void grow()
+        {
+          auto capacity = Capacity ? 2 * Capacity : 4;
+          auto senders  = new S*[capacity];
+          for (size_t index = 0; index < Size; ++index)
+            senders[index] = Senders.get()[index];
+
+          delete[] Senders.get();
+          Senders.keep_flag_assign_pointer(senders);
+          Capacity = capacity;
+        }
+
+        void rotate(size_t middle)
+          // senders[middle, Size) followed by senders[0, middle)
+        {
+          auto senders = Senders.get();
+          auto reverse = [senders](size_t first, size_t last)
+          {
+            while ((first != last) and (first != --last))
+            {
+              auto sender = senders[first];
+              senders[first++] = senders[last];
+              senders[last]    = sender;
+            }
+          };
+
+          reverse(0, middle);
+          reverse(middle, Size);
+          reverse(0, Size);
+
+          for (size_t index = 0; index < Size; ++index)
+            if (senders[index])
+              senders[index]->Slot = index;
+
+          Split = 0;
+        }
+
+        void compact()
+        {
+          auto senders = Senders.get();
+          size_t count{0};
+          size_t split{0};
+          for (size_t index = 0; index < Size; ++index)
+          {
+            if (index == Split)
+              split = count;
+
+            if (auto sender = senders[index])
+            {
+              sender->Slot = count;
+              senders[count++] = sender;
+            }
+          }
+
+          Split = split;
+          Size  = count;
+          Holes = 0;
+        }
+    };
+
+    template <typename S, size_t K, size_t SlotSize>
+    class sender_inline: public sender_list<S>, public allocator
+      // A sender_list that keeps the first K senders in slots inside the message, 
+      // so a message with few senders sends without touching the heap.
+      // Further senders spill to the usual places.
+    {
+      static_assert(K > 0 and K <= 32, "K must be in [1, 32]");
+      static_assert(SlotSize > 0 and SlotSize % alignof(std::max_align_t) == 0, 
+                    "SlotSize must be a multiple of alignof(std::max_align_t), so every slot stays aligned");
+
+      public:
+        sender_inline() = default;
+        sender_inline(sender_inline const&):sender_inline() { }  // a copy starts without senders
+
+        template <typename T>
+        allocator* inline_allocator()
+        {
+          return (sizeof (T) <= SlotSize) and (alignof(T) <= alignof(std::max_align_t)) and 
+                 (Used != Full) ? this : nullptr;
+        }
+
+        void* allocate(size_t, size_t) override
+          // only used for senders that fit, see inline_allocator
+        {
+          size_t index{0};
+          while(Used & (std::uint32_t{1} << index))
+            ++index;
+
+          Used |= std::uint32_t{1} << index;
+          return Slots[index];
+        }
+
+        void deallocate(void* pointer, size_t, size_t) override
+        {
+          auto index = static_cast<size_t>(static_cast<unsigned char*>(pointer) - Slots[0]) / SlotSize;
+          Used &= ~(std::uint32_t{1} << index);
+        }
+
+      private:
+        static const std::uint32_t Full = ~std::uint32_t{0} >> (32 - K);
+
+        std::uint32_t Used{0};  // bit per slot
+        alignas(std::max_align_t) unsigned char Slots[K][SlotSize];
+    };
+
+  } // namespace detail
+
+#if PIGEON_METRICS
+  class message_metrics
+    // What happened to one message, enumerate all of them with metrics_registry::for_each.
+    // Counting is not synchronized, read the metrics on the thread sending the message.
+  {
+    public:
+      static const size_t HistorySize = 16;
+
+      const char* name() const { return Name; }
+      void name(const char* name) { Name = name; }  // not copied, a string literal
+
+      size_t sends            () const { return Sends;            }
+      size_t invocations      () const { return Invocations;      }  // handler calls
+      size_t reaped           () const { return Reaped;           }  // dead senders removed while sending
+      size_t repeats          () const { return Repeats;          }
+      size_t finishes         () const { return Finishes;         }
+      size_t ignored_reentrant() const { return IgnoredReentrant; }  // sends while sending
+      size_t peak_subscribers () const { return PeakSubscribers;  }
+
+      size_t history_size() const { return Sends < HistorySize ? Sends : HistorySize; }
+      size_t history(size_t index) const
+        // subscribers at one of the last sends, 0 is the oldest
+      { return History[(Sends - history_size() + index) % HistorySize]; }
+
+    protected:
+      message_metrics() { attach(); }
+      message_metrics(message_metrics const&):message_metrics() { }  // a copy starts counting anew
+     ~message_metrics() { detach(); }
+      message_metrics& operator=(message_metrics const&) { return *this; }
+
+      void metrics_send(size_t subscribers)
+      {
+        History[Sends % HistorySize] = subscribers;
+        ++Sends;
+        if (subscribers > PeakSubscribers)
+          PeakSubscribers = subscribers;
+      }
+
+      void metrics_visit(bool dropped, iteration_state state)
+      {
+        if (not dropped)
+          ++Invocations;
+        switch (state)
+        {
+          case iteration_state::dead  : ++Reaped;   break;
+          case iteration_state::repeat: ++Repeats;  break;
+          case iteration_state::finish: ++Finishes; break;
+          default: break;
+        }
+      }
+
+      void metrics_ignore() { ++IgnoredReentrant; }
+
+    private:
+      friend class metrics_registry;
+
+      static std::mutex& registry_mutex()
+      {
+        static std::mutex Mutex;
+        return Mutex;
+      }
+
+      static message_metrics*& registry_head()
+      {
+        static message_metrics* Head{nullptr};
+        return Head;
+      }
+
+      void attach()
+      {
+        std::lock_guard<std::mutex> lock{registry_mutex()};
+        Next = registry_head();
+        if (Next)
+          Next->Previous = this;
+        registry_head() = this;
+      }
+
+      void detach()
+      {
+        std::lock_guard<std::mutex> lock{registry_mutex()};
+        if (Previous)
+          Previous->Next = Next;
+        else
+          registry_head() = Next;
+        if (Next)
+          Next->Previous = Previous;
+      }
 
-      void destruct() override
-      { 
-        auto alloc = Alloc;
-        this->~inbox_with_allocator();
-        alloc->deallocate(this, sizeof (inbox_with_allocator)); 
+      message_metrics* Previous{nullptr};
+      message_metrics* Next    {nullptr};
+      const char*      Name    {""};
+
+      size_t Sends           {0};
+      size_t Invocations     {0};
+      size_t Reaped          {0};
+      size_t Repeats         {0};
+      size_t Finishes        {0};
+      size_t IgnoredReentrant{0};
+      size_t PeakSubscribers {0};
+      size_t History[HistorySize] = {};
+  };
+
+  class metrics_registry
+    // All messages alive, while PIGEON_METRICS is 1
+  {
+    public:
+      template <typename F>
+      static void for_each(F&& f)
+        // f(message_metrics const&), do not create or destroy messages inside f
+      {
+        std::lock_guard<std::mutex> lock{message_metrics::registry_mutex()};
+        for (auto metrics = message_metrics::registry_head(); metrics; metrics = metrics->Next)
+          f(static_cast<message_metrics const&>(*metrics));
       }
-    };
 
-    struct noop { void operator()(contact_token, who) { } };
+      template <typename O>
+      static void export_text(O& out)
+        // One line per message, e.g. for std::ostream
+      {
+        for_each([&out](message_metrics const& metrics)
+          {
+            out << (*metrics.name() ? metrics.name() : "<unnamed>")
+                << " sends="             << metrics.sends()
+                << " invocations="       << metrics.invocations()
+                << " reaped="            << metrics.reaped()
+                << " repeats="           << metrics.repeats()
+                << " finishes="          << metrics.finishes()
+                << " ignored_reentrant=" << metrics.ignored_reentrant()
+                << " peak_subscribers="  << metrics.peak_subscribers() << '\n';
+          });
+      }
+  };
 
-    template <typename R, typename F>
-    struct handler
+  namespace detail { using metrics_base = message_metrics; }
+#else
+  namespace detail
+  {
+    struct metrics_base
+      // Nothing to count, the empty base costs nothing
     {
-      R* self;
-      F f;
-
-      template <typename ...Args>
-      auto operator()(Args&& ...args)
-        -> decltype((self->*f)(std::forward<Args>(args)...))
-      { return (self->*f)(std::forward<Args>(args)...); }
+      void metrics_send  (size_t) { }
+      void metrics_visit (bool, iteration_state) { }
+      void metrics_ignore() { }
     };
+  }
+#endif
 
-    template <typename ...Args> struct argument_checker;
-
-    template <> struct argument_checker<> 
-    { static const bool value = true; };
+  struct list_storage
+    // Default storage, a sender costs one pointer inside the sender itself
+  {
+    template <typename S> using container = detail::sender_list<S>;
+  };
 
-    template <typename Arg, typename ...Args>
-    struct argument_checker<Arg, value_state&, Args...>: argument_checker<Args...> { };
+  struct array_storage
+    // Keeps the senders in one contiguous array, preferable for messages with many senders
+  {
+    template <typename S> using container = detail::sender_array<S>;
+  };
 
-    template <typename Arg, typename ...Args>
-    struct argument_checker<Arg, Args...>: argument_checker<Args...>
-    { 
-      static_assert(!std::is_rvalue_reference<Arg>::value, 
-        "RValue reference not allowed as arguments without a "
-        "following associated pigeon::value_state& argument"
-      ); 
+  template <size_t K, size_t SlotSize = detail::slot_pool::SlotSize>
+  struct inline_storage
+    // Default storage with the first K senders inside the message, 
+    // preferable for messages with one to a few senders
+  {
+    template <typename S> using container = detail::sender_inline<S, K, SlotSize>;
+  };
 
-      static_assert(!std::is_lvalue_reference<Arg>::value ||
-        std::is_const<typename std::remove_reference<Arg>::type>::value, 
-        "LValue reference must be const or followed by "
-        "an associated pigeon::value_state& argument"
-      ); 
-    };
+  template <size_t N, typename S = list_storage>
+  struct deferred_storage: S
+    // The storage S plus room for N reentrant sends inside the message,
+    // replayed after the outermost send instead of being ignored
+  { };
 
-  } // namespace detail
+  namespace detail
+  {
+    template <typename S>              struct deferred_capacity                         : std::integral_constant<size_t, 0> { };
+    template <size_t N, typename S>    struct deferred_capacity<deferred_storage<N, S>> : std::integral_constant<size_t, N> { };
+  }
 
-  template <typename R, typename ...Args>
-  class message<R(Args...), protected_access>
+  template <typename R, typename ...Args, typename S>
+  class message<R(Args...), protected_access, S>: public detail::metrics_base, 
+    private detail::deferred_queue<detail::deferred_capacity<S>::value, Args...>
   { 
     static_assert(detail::argument_checker<Args...>::value, 
       "Check Arguments for non-const references."
@@ -262,22 +1754,16 @@ namespace pigeon
 
     public:
      ~message() { clear(); }
-      bool isSending() const { return Senders.test(); }
+      bool isSending() const { return Senders.isSending(); }
 
-    protected: 
-      size_t size() const
-      {
-        size_t counter{0};
-        auto sender = Senders.get();
-        while(sender)
-        {
-          if (not sender->isDropped())
-            ++counter;
+#if PIGEON_METRICS
+      message_metrics&       metrics()       { return *this; }
+      message_metrics const& metrics() const { return *this; }
+#endif
 
-          sender = sender->NextSender.get();
-        }
-        return counter;
-      }
+    protected: 
+      size_t size           () const { return Senders.size(); }
+      bool   has_subscribers() const { return Senders.size() != 0; }
 
       void ensureNotSending() const
       {
@@ -288,37 +1774,19 @@ namespace pigeon
       void clear()
       {
         ensureNotSending(); 
-        auto sender = Senders.get();
-        Senders.keep_flag_assign_pointer(nullptr);
-        while(sender)
-        {
-          auto next = sender->NextSender.get();
-          sender->drop(who::message);
-          sender = next;
-        }
+        Senders.clear();
       }
 
       bool drop(contact_token token)
+        // O(1), its pigeon may be gone already, the table of the token is recycled but not freed
       {
         ensureNotSending(); 
-        auto previous_sender = &Senders;
-        auto sender = Senders.get();
-        while(sender)
-        {
-          if (sender == token.contact)
-          {
-            auto next = sender->NextSender.get();
-            previous_sender->keep_flag_assign_pointer(next);
-            sender->drop(who::message);
-            return true;
-          }
-          else
-          {
-            previous_sender = &sender->NextSender;
-            sender          =  sender->NextSender.get();
-          }
-        }
-        return false;
+        auto contact = token.Table ? token.Table->find(token) : nullptr;
+        if (not Senders.owns(contact))
+          return false;
+
+        Senders.erase(static_cast<sender_type*>(contact));
+        return true;
       }
 
       template <typename H>
@@ -326,168 +1794,204 @@ namespace pigeon
       { 
         // We purposely silently ignore reentrant responding through user provided handlers
         if (isSending())
+          return this->metrics_ignore();
+
+        auto deferred = this->outermost();
+        // A single sender is visited once at most, even with repeat, so it gets the arguments themselves
+        auto const single = Senders.size() == 1;
+        this->metrics_send(Senders.size());
+        Senders.iterate([&](sender_type& sender)
+          { 
+            auto state = sender.try_send(h, detail::hand_over<Args>::of(args, single)...); 
+            this->metrics_visit(state == iteration_state::dead and sender.isDropped(), state);
+            return state;
+          }
+        );
+        replay_deferred();
+      }
+
+      void send(Args ...args) 
+      { 
+        // With deferred_storage a reentrant send waits for the end of the outermost send
+        if (isSending() and this->defer(args...))
           return;
 
-        // set isSending true here in exception safe RAII fashion
-        auto guard = Senders.scoped_set();
+        response(std::forward<Args>(args)... , [](...){ }); 
+      }
 
-        auto previous_sender = &Senders;
-        auto sender = Senders.get();
-        while(sender)
-        {
-          switch(sender->try_send(h, std::forward<Args>(args)...))
-          {
-            case iteration_state::dead:
-            {
-              auto next = sender->NextSender.get();
-              previous_sender->keep_flag_assign_pointer(next); 
-              sender->drop(who::message);
-              sender = next;
-              break;
-            }
+      void send_batch(batch_view<typename detail::batch_element<R, Args...>::type> events)
+        // Walks the senders once for all events, each sender gets all events before the next one
+      {
+        static_assert(not std::is_same<typename detail::batch_element<R, Args...>::type, detail::no_batch>::value,
+          "send_batch needs a message with one copyable argument and void return type");
 
-            case iteration_state::progress:
-              previous_sender = &sender->NextSender;
-              sender = sender->NextSender.get();
-              break;
+        // We purposely silently ignore reentrant sending through user provided handlers
+        if (isSending())
+          return this->metrics_ignore();
+        if (events.empty())
+          return;
 
-            case iteration_state::repeat:
+        auto deferred = this->outermost();
+        this->metrics_send(Senders.size());
+        Senders.iterate([this, &events](sender_type& sender)
+          {
+            if (sender.isDropped())
             {
-              // Do not change the order of these steps without intense scrutiny
-              // Modify linked list so we will repeat the OTHER senders, but
-              // not the active sender
-              
-              // find lastSender
-              auto lastSender = sender;
-              while(lastSender->NextSender)
-                lastSender = lastSender->NextSender.get();
-
-              // unlink sender and make new list end 
-              previous_sender->keep_flag_assign_pointer(nullptr);
-
-              // splice
-              lastSender->NextSender.keep_flag_assign_pointer(Senders);
-              Senders.keep_flag_assign_pointer(sender);
-
-              // next
-              previous_sender = &sender->NextSender;
-              sender = sender->NextSender.get();
-              break;
+              this->metrics_visit(true, iteration_state::dead);
+              return iteration_state::dead;
             }
 
-            case iteration_state::finish:
-              return;
+            sender.send_batch(events);
+            this->metrics_visit(false, iteration_state::progress);
+            return iteration_state::progress;
           }
-        }
+        );
+        replay_deferred();
       }
 
-      void send(Args ...args) 
-      { response(std::forward<Args>(args)... , [](...){ }); }
-
     private:
       friend class pigeon;
+      template <typename> friend class detail::parallel_sender;
 
       using sender_type = detail::sender<R, Args...>;
 
-      detail::flag_pointer<sender_type> Senders;
+      void replay_deferred()
+      { this->replay([this](Args ...args) { send(std::forward<Args>(args)...); }); }
+
+      typename S::template container<sender_type> Senders;
 
       template<typename H, typename F>
-      detail::contact* make_contact(H&& handler, allocator* alloc, F&& f)
+      detail::contact* make_contact(H&& handler, allocator* alloc, F&& f, std::int16_t priority)
       {
         ensureNotSending(); 
 
-        auto sender = [alloc, &handler, &f] () -> sender_type*
-        {
-          using handler_type = typename std::remove_reference<H>::type;
-          using drop_type    = typename std::remove_reference<F>::type;
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+        using inbox_type   = typename detail::inbox_with_allocator<handler_type, drop_type, R, Args...>;
 
-          if (alloc)
-          {
-            using inbox_type = typename detail::inbox_with_allocator<handler_type, drop_type, R, Args...>;
-            auto space = alloc->allocate(sizeof (inbox_type));
-            return new (space) inbox_type{std::forward<H>(handler), alloc, std::forward<F>(f)};
-          }
-          else
-           return new detail::inbox<handler_type, drop_type, R, Args...>{std::forward<H>(handler), std::forward<F>(f)};
-        }();
-
-        // Messages get delivered in reverse order of deliver calls 
-        // which might be counter intuitive, but I do not guarantee
-        // any order and even change it with iteration_state::repeat
-        sender->NextSender.keep_flag_assign_pointer(Senders);
-        Senders.keep_flag_assign_pointer(sender);
+        if (not alloc)
+          alloc = Senders.template inline_allocator<inbox_type>();
+
+        sender_type* sender;
+        if (alloc)
+          sender = make_inbox<inbox_type>(std::forward<H>(handler), alloc, std::forward<F>(f));
+        else
+          sender = make_inbox<inbox_type>(std::forward<H>(handler), std::forward<F>(f), 
+            std::integral_constant<bool, detail::slot_pool::fits<inbox_type>::value>{});
+
+        sender->Priority = priority;
+        Senders.push(sender);
+        return sender;
+      }
+
+      template<typename H, typename P, typename F>
+      detail::contact* make_contact(H&& handler, detail::policy<P>, F&& f, std::int16_t priority)
+      {
+        ensureNotSending(); 
+
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+        using inbox_type   = typename detail::inbox_with_policy<P, handler_type, drop_type, R, Args...>;
+
+        auto space  = P::allocate(sizeof (inbox_type), alignof(inbox_type));
+        auto sender = new (space) inbox_type{std::forward<H>(handler), std::forward<F>(f)};
+        sender->Priority = priority;
+        Senders.push(sender);
         return sender;
       }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, allocator* alloc, F&& f)
+      {
+        auto space = alloc->allocate(sizeof (I), alignof(I));
+        return new (space) I{std::forward<H>(handler), alloc, std::forward<F>(f)};
+      }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, F&& f, std::true_type /* fits into a slot */)
+      { return make_inbox<I>(std::forward<H>(handler), &detail::slot_pool::local(), std::forward<F>(f)); }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_inbox(H&& handler, F&& f, std::false_type /* too big for a slot */)
+      { 
+        return make_heap_inbox<I>(std::forward<H>(handler), std::forward<F>(f), 
+          std::integral_constant<bool, (alignof(I) > alignof(std::max_align_t))>{}); 
+      }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_heap_inbox(H&& handler, F&& f, std::true_type /* over-aligned */)
+      { return make_inbox<I>(std::forward<H>(handler), &detail::aligned_heap::instance(), std::forward<F>(f)); }
+
+      template <typename I, typename H, typename F>
+      static sender_type* make_heap_inbox(H&& handler, F&& f, std::false_type)
+      {
+        using handler_type = typename std::remove_reference<H>::type;
+        using drop_type    = typename std::remove_reference<F>::type;
+        return new detail::inbox<handler_type, drop_type, R, Args...>{std::forward<H>(handler), std::forward<F>(f)};
+      }
   };
 
-  template <typename R, typename ...Args>
-  struct message<R(Args...), global_access>: message<R(Args...), protected_access>
+  template <typename R, typename ...Args, typename S>
+  struct message<R(Args...), global_access, S>: message<R(Args...), protected_access, S>
   { 
-    using base = message<R(Args...), protected_access>;
+    using base = message<R(Args...), protected_access, S>;
     using base::size;
+    using base::has_subscribers;
     using base::clear;
     using base::drop;
     using base::response;
     using base::send;
+    using base::send_batch;
   };
 
-  template <typename R, typename ...Args, typename F>
-  class message<R(Args...), F>: public message<R(Args...), protected_access>
+  template <typename R, typename ...Args, typename F, typename S>
+  class message<R(Args...), F, S>: public message<R(Args...), protected_access, S>
   { 
     protected:
       friend F;
 
-      using base = message<R(Args...), protected_access>;
+      using base = message<R(Args...), protected_access, S>;
       using base::size;
+      using base::has_subscribers;
       using base::clear;
       using base::drop;
       using base::response;
       using base::send;
+      using base::send_batch;
   };
 
-  namespace detail { template <typename> class deliver_proxy; }
+  class pigeon;
+  namespace detail { template <typename, typename = pigeon> class deliver_proxy; }
   class pigeon
   {
     public:
       pigeon() = default;
-     ~pigeon() { setDestructing(); clear(); }
+      pigeon(pigeon const&):pigeon() { }  // a copy starts without contacts
+     ~pigeon() 
+      { 
+        setDestructing(); 
+        clear(); 
+        if (contacts) 
+          detail::contact_table::recycle(contacts.get()); 
+      }
 
       size_t size() const
       {
         ensureNotDestructing();
-        size_t counter{0};
-        auto contact = contacts.get();
-        while(contact)
-        {
-          if (not contact->isDropped())
-            ++counter;
-
-          contact = contact->NextContact.get();
-        }
-        return counter;
+        return contacts ? contacts.get()->size() : 0;
       }
 
+      bool has_subscribers() const { return size() != 0; }
+
       void clear()
       {
-        auto contact = contacts.get();
-        contacts.keep_flag_assign_pointer(nullptr);
-        while(contact)
-        {
-          auto next = contact->NextContact.get();
-          contact->drop(who::pigeon);
-          contact = next;
-        }
+        if (contacts)
+          contacts.get()->clear();
       }
 
       template <typename M, typename I, typename F = detail::noop>
-      contact_token deliver(M& message, I&& inbox, allocator* alloc = nullptr, F&& f = F{}) 
-      {
-        ensureNotDestructing();
-        auto contact = message.make_contact(std::forward<I>(inbox), alloc, std::forward<F>(f));
-        contact->NextContact.keep_flag_assign_pointer(contacts);
-        contacts.keep_flag_assign_pointer(contact);
-        return contact_token{contact};
-      } 
+      contact_token deliver(M& message, I&& inbox, allocator* alloc = nullptr, F&& f = F{}, std::int16_t priority = 0) 
+      { return deliver_contact(message, std::forward<I>(inbox), alloc, std::forward<F>(f), priority); } 
 
       template <typename M>
       detail::deliver_proxy<M> deliver(M& message) 
@@ -497,30 +2001,34 @@ namespace pigeon
 
       bool drop(contact_token token)
       {
-        auto previous_contact = &contacts;
-        auto contact = contacts.get();
-        while(contact)
-        {
-          if (contact == token.contact)
-          {
-            auto next = contact->NextContact;
-            previous_contact->keep_flag_assign_pointer(next);
-            contact->drop(who::pigeon);
-            return true;
-          }
-          else
-          {
-            // continue search
-            previous_contact = &contact->NextContact;
-            contact = contact->NextContact.get();
-          }
-        }
-        return false;
+        auto contact = contacts ? contacts.get()->find(token) : nullptr;
+        if (not contact)
+          return false;
+
+        contact->drop(who::pigeon);
+        return true;
       }
 
+    protected:
+      bool clear_detached()
+        // Like clear, false if a sending message keeps one of the contacts until it reaps it
+      { return not contacts or contacts.get()->clear(); }
+
+      template <typename M, typename I, typename A, typename F>
+      contact_token deliver_contact(M& message, I&& inbox, A alloc, F&& f, std::int16_t priority) 
+        // A is an allocator* or a detail::policy
+      {
+        ensureNotDestructing();
+        if (not contacts)
+          contacts.keep_flag_assign_pointer(detail::contact_table::acquire());
+
+        contacts.get()->reserve();
+        auto contact = message.make_contact(std::forward<I>(inbox), alloc, std::forward<F>(f), priority);
+        return contacts.get()->insert(contact);
+      } 
+
     private:
-      // Because of previous_contact, the type of contacts must match NextContact
-      detail::flag_pointer<detail::contact> contacts;
+      detail::flag_pointer<detail::contact_table> contacts;  // flag stores destructing
       void setDestructing() { contacts.set(); }
       void ensureNotDestructing() const
       {
@@ -547,13 +2055,14 @@ namespace pigeon
 
   namespace detail
   {
-    template <typename, typename> class deliver_onDrop_helper;
+    template <typename, typename, typename> class deliver_onDrop_helper;
 
-    template <typename M>
+    template <typename M, typename P>
     class deliver_proxy
+      // P is the pigeon delivering
     {
       public:
-        deliver_proxy(pigeon& pigeon, M& message, allocator* alloc = nullptr)
+        deliver_proxy(P& pigeon, M& message, allocator* alloc = nullptr)
          : Pigeon(pigeon), Message(message), Allocator(alloc) { }
 
         deliver_proxy(deliver_proxy const&) = default;
@@ -561,30 +2070,35 @@ namespace pigeon
         deliver_proxy& withAllocator(allocator* alloc)
         { Allocator = alloc; return *this; }
 
+        deliver_proxy& withPriority(std::int16_t priority)
+          // Higher priorities get the message first, the default is 0
+        { Priority = priority; return *this; }
+
         template <typename I, typename F = detail::noop>
         contact_token to(I&& box, F&& onDrop = F{})
-        { return Pigeon.deliver(Message, std::forward<I>(box), Allocator, std::forward<F>(onDrop)); }
+        { return Pigeon.deliver(Message, std::forward<I>(box), Allocator, std::forward<F>(onDrop), Priority); }
 
         template <typename F>
-        deliver_onDrop_helper<M, F> onDrop(F&& f) 
+        deliver_onDrop_helper<M, F, P> onDrop(F&& f) 
         { return {*this, std::forward<F>(f)}; }
 
       private:
-        pigeon& Pigeon;
+        P& Pigeon;
         M& Message;
         allocator* Allocator;
+        std::int16_t Priority{0};
     };
 
-    template <typename M, typename F> 
-    class deliver_onDrop_helper: public deliver_proxy<M>
+    template <typename M, typename F, typename P> 
+    class deliver_onDrop_helper: public deliver_proxy<M, P>
     {
-        using Base = deliver_proxy<M>;
+        using Base = deliver_proxy<M, P>;
 
       public:
         deliver_onDrop_helper(Base const& helper, F&& ff)
          :Base(helper), f(std::forward<F>(ff)) { }
 
-        deliver_onDrop_helper(pigeon& pigeon, M& message, allocator* alloc, F&& ff)
+        deliver_onDrop_helper(P& pigeon, M& message, allocator* alloc, F&& ff)
          :Base(pigeon, message, alloc), f(std::forward<F>(ff)) { }
 
         template <typename I>
@@ -592,21 +2106,10 @@ namespace pigeon
         { return Base::to(std::forward<I>(box), std::forward<F>(f)); }
        
       private:
-        using deliver_proxy<M>::onDrop;
+        using Base::onDrop;
         F f; 
     };
 
-    template <typename M>
-    struct onDrop_handler 
-    { 
-      M& Message;
-      void operator()(contact_token token, who w) 
-      { 
-        if (w == who::pigeon)
-          Message.drop(token); 
-      }
-    };
-
   } // namespace detail
 
   template<size_t N>
@@ -618,18 +2121,21 @@ namespace pigeon
    ~arena_heap_allocator() { delete[] Memory; }
 
     size_t capacity() const { return N; }
+    size_t used    () const { return ByteIndex; }
 
-    void* allocate(size_t size_bytes) override
+    void* allocate(size_t size_bytes, size_t alignment) override
     {
-      auto oldByteIndex = ByteIndex;
-      ByteIndex += ((size_bytes + MinAlignment - 1)/ MinAlignment) * MinAlignment;
-      if (ByteIndex >= N)
+      auto padding = detail::padding(&Memory[ByteIndex], alignment < MinAlignment ? MinAlignment : alignment);
+      auto size    = ((size_bytes + MinAlignment - 1)/ MinAlignment) * MinAlignment;
+      if (padding > N - ByteIndex or size > N - ByteIndex - padding)
         throw std::logic_error("Not enough memory");
 
+      auto oldByteIndex = ByteIndex + padding;
+      ByteIndex = oldByteIndex + size;
       return &Memory[oldByteIndex]; 
     }
 
-    void deallocate(void*, size_t) override { }
+    void deallocate(void*, size_t, size_t) override { }
 
     unsigned char* Memory;
     size_t ByteIndex{0};
@@ -641,56 +2147,327 @@ namespace pigeon
     static const size_t MinAlignment = sizeof(void*);
 
     size_t capacity() const { return N; }
+    size_t used    () const { return ByteIndex; }
    
-    void* allocate(size_t size_bytes) override
+    void* allocate(size_t size_bytes, size_t alignment) override
     {
-      auto oldByteIndex = ByteIndex;
-      ByteIndex += ((size_bytes + MinAlignment - 1)/ MinAlignment) * MinAlignment;
-      if (ByteIndex >= N)
+      auto padding = detail::padding(&Memory[ByteIndex], alignment < MinAlignment ? MinAlignment : alignment);
+      auto size    = ((size_bytes + MinAlignment - 1)/ MinAlignment) * MinAlignment;
+      if (padding > N - ByteIndex or size > N - ByteIndex - padding)
         throw std::logic_error("Not enough memory");
 
+      auto oldByteIndex = ByteIndex + padding;
+      ByteIndex = oldByteIndex + size;
       return &Memory[oldByteIndex]; 
     }
 
-    void deallocate(void*, size_t) override { }
+    void deallocate(void*, size_t, size_t) override { }
 
     unsigned char Memory[N];
     size_t ByteIndex{0};
   };
 
+  template <size_t InitialSize = 1024, size_t MaxSize = 0>
+  class arena_chunk_allocator: public allocator
+    // An arena that grows: when a chunk is full the next one is twice as big, 
+    // the chunks before stay where they are. The first chunk is allocated on first use.
+    // MaxSize caps the bytes of all chunks, 0 means no cap.
+  {
+    public:
+      static const size_t MinAlignment = sizeof(void*);
+
+      static_assert(InitialSize > 0, "arena_chunk_allocator needs a first chunk");
+      static_assert(MaxSize == 0 or MaxSize >= InitialSize, "the first chunk has to fit into MaxSize");
+
+      arena_chunk_allocator() = default;
+      arena_chunk_allocator(arena_chunk_allocator const&) = delete;
+      arena_chunk_allocator& operator=(arena_chunk_allocator const&) = delete;
+     ~arena_chunk_allocator()
+      {
+        while (Current)
+        {
+          auto previous = Current->Previous;
+          delete[] reinterpret_cast<unsigned char*>(Current);
+          Current = previous;
+        }
+      }
+
+      void* allocate(size_t size_bytes, size_t alignment) override
+      {
+        if (alignment < MinAlignment)
+          alignment = MinAlignment;
+
+        auto size    = ((size_bytes + MinAlignment - 1)/ MinAlignment) * MinAlignment;
+        auto padding = Current ? detail::padding(memory() + ByteIndex, alignment) : 0;
+        if (not Current or padding > Current->Size - ByteIndex or size > Current->Size - ByteIndex - padding)
+        {
+          // a chunk starts aligned to std::max_align_t
+          grow(alignment > alignof(std::max_align_t) ? size + alignment - alignof(std::max_align_t) : size);
+          padding = detail::padding(memory(), alignment);
+        }
+
+        auto pointer = memory() + ByteIndex + padding;
+        ByteIndex += padding + size;
+        Used      += padding + size;
+        return pointer;
+      }
+
+      void deallocate(void*, size_t, size_t) override { }
+
+      size_t capacity() const { return Capacity; }  // bytes in all chunks
+      size_t used    () const { return Used; }
+      size_t chunks  () const { return Chunks; }
+
+    private:
+      struct chunk 
+      { 
+        chunk* Previous; 
+        size_t Size; 
+      };
+
+      static const size_t HeaderSize = ((sizeof(chunk) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)) * alignof(std::max_align_t);
+
+      unsigned char* memory() const { return reinterpret_cast<unsigned char*>(Current) + HeaderSize; }
+
+      void grow(size_t size)
+      {
+        auto chunkSize = Current ? 2 * Current->Size : InitialSize;
+        if (chunkSize < size)
+          chunkSize = size;
+        if (MaxSize and chunkSize > MaxSize - Capacity)
+          chunkSize = MaxSize - Capacity;  // the last chunk takes what is left
+        if (chunkSize < size)
+          throw std::logic_error("Not enough memory");
+
+        auto header = reinterpret_cast<chunk*>(new unsigned char[HeaderSize + chunkSize]);
+        header->Previous = Current;
+        header->Size     = chunkSize;
+        Current   = header;
+        ByteIndex = 0;
+        Capacity += chunkSize;
+        ++Chunks;
+      }
+
+      chunk* Current  {nullptr};
+      size_t ByteIndex{0};  // in the current chunk
+      size_t Capacity {0};
+      size_t Used     {0};
+      size_t Chunks   {0};
+  };
+
+  template <size_t Classes = 16, size_t ChunkSize = 4096>
+  class pool_allocator: public allocator
+    // Reuses freed memory: one free list per size class, allocate and deallocate are O(1).
+    // Size classes are multiples of alignof(std::max_align_t), each chunk serves one size class.
+    // The inboxes of one handler type always have the same size, so churn with the same
+    // handler types runs without the heap once the chunks are there.
+    // Bigger or over-aligned requests go to the heap directly.
+  {
+    public:
+      static const size_t Granularity  = alignof(std::max_align_t);
+      static const size_t MaxBlockSize = Classes * Granularity;
+
+      static_assert(Classes > 0, "pool_allocator needs a size class");
+      static_assert(ChunkSize >= Granularity + MaxBlockSize, "a chunk must hold a block of the biggest size class");
+
+      pool_allocator() = default;
+      pool_allocator(pool_allocator const&) = delete;
+      pool_allocator& operator=(pool_allocator const&) = delete;
+     ~pool_allocator()
+      {
+        while (Chunks)
+        {
+          auto next = Chunks->Next;
+          delete[] reinterpret_cast<unsigned char*>(Chunks);
+          Chunks = next;
+        }
+      }
+
+      void* allocate(size_t size_bytes, size_t alignment) override
+      {
+        ++Allocations;
+        if (size_bytes > MaxBlockSize or alignment > Granularity)
+        {
+          ++HeapAllocations;
+          Capacity += size_bytes;
+          Used     += size_bytes;
+          return alignment <= Granularity ? ::operator new(size_bytes) : detail::aligned_new(size_bytes, alignment);
+        }
+
+        auto index = size_class(size_bytes);
+        if (not FreeBlocks[index])
+          grow(index);
+
+        auto block = FreeBlocks[index];
+        FreeBlocks[index] = block->Next;
+        Used += block_size(index);
+        return block;
+      }
+
+      void deallocate(void* pointer, size_t size_bytes, size_t alignment) override
+      {
+        ++Deallocations;
+        if (size_bytes > MaxBlockSize or alignment > Granularity)
+        {
+          Capacity -= size_bytes;
+          Used     -= size_bytes;
+          if (alignment > Granularity)
+            detail::aligned_delete(pointer);
+          else
+            ::operator delete(pointer);
+          return;
+        }
+
+        auto index = size_class(size_bytes);
+        auto block = static_cast<free_block*>(pointer);
+        block->Next = FreeBlocks[index];
+        FreeBlocks[index] = block;
+        Used -= block_size(index);
+      }
+
+      size_t capacity        () const { return Capacity;        }  // bytes in chunks and big blocks
+      size_t used            () const { return Used;            }  // bytes handed out, rounded to the size classes
+      size_t allocations     () const { return Allocations;     }
+      size_t deallocations   () const { return Deallocations;   }
+      size_t heap_allocations() const { return HeapAllocations; }  // chunks and big requests
+
+    private:
+      struct free_block { free_block* Next; };
+      struct chunk      { chunk* Next; };
+        // The chunk header takes the space of one granule, to keep the blocks aligned
+
+      static size_t size_class(size_t size_bytes) { return size_bytes ? (size_bytes - 1) / Granularity : 0; }
+      static size_t block_size(size_t index)      { return (index + 1) * Granularity; }
+
+      void grow(size_t index)
+      {
+        auto memory = new unsigned char[ChunkSize];
+        auto header = reinterpret_cast<chunk*>(memory);
+        header->Next = Chunks;
+        Chunks = header;
+        Capacity += ChunkSize;
+        ++HeapAllocations;
+
+        auto size = block_size(index);
+        for (auto offset = Granularity; offset + size <= ChunkSize; offset += size)
+        {
+          auto block = reinterpret_cast<free_block*>(memory + offset);
+          block->Next = FreeBlocks[index];
+          FreeBlocks[index] = block;
+        }
+      }
+
+      free_block* FreeBlocks[Classes] = {};
+      chunk*      Chunks         {nullptr};
+      size_t      Capacity       {0};
+      size_t      Used           {0};
+      size_t      Allocations    {0};
+      size_t      Deallocations  {0};
+      size_t      HeapAllocations{0};
+  };
+
+  template <typename H>
+  detail::batch_handler<typename std::decay<H>::type> batch(H&& handler)
+    // Marks a handler taking a whole batch_view, message.send_batch calls it once per batch
+    // and message.send calls it with a batch of one event
+  { return detail::batch_handler<typename std::decay<H>::type>{std::forward<H>(handler)}; }
+
   template<typename A>
   class allocator_pigeon: pigeon
   {
       using base = pigeon;
 
     public:
-      ~allocator_pigeon() { clear(); }
+      ~allocator_pigeon() { ensureDetached(clear_detached()); }
 
       using base::size;
+      using base::has_subscribers;
       using base::clear;
       using base::drop;
 
       template <typename M>
-      detail::deliver_onDrop_helper<M, detail::onDrop_handler<M>> deliver(M& message) 
+      detail::deliver_proxy<M> deliver(M& message) 
       {
-        return {*this, message, &allocator, detail::onDrop_handler<M>{message}};
+        return {*this, message, &allocator};
       }
 
       template <typename M, typename I>
       contact_token deliver(M& message, I&& box) 
       {
         // When the allocator_pigeon goes away, the memory with the contact information goes away too!
-        // We have to delete them properly, what means the message has to drop the contact to.
-        // The onDrop_handler does this with the onDrop callback mechanism
-        return base::deliver(message, std::forward<I>(box), &allocator, detail::onDrop_handler<M>{message});
+        // This is fine, because clear drops every contact from its message at once.
+        // A message sending right now can not let go of its contacts, 
+        // so the allocator_pigeon must not be destroyed by one of their handlers.
+        return base::deliver(message, std::forward<I>(box), &allocator);
       }
 
       size_t total_memory    () const { return allocator.capacity(); }
-      size_t used_memory     () const { return allocator.ByteIndex; }
+      size_t used_memory     () const { return allocator.used(); }
       size_t available_memory() const { return total_memory() - used_memory(); }
 
+      A const& get_allocator () const { return allocator; }
+
     private:
       A allocator;
+
+      static void ensureDetached(bool detached)
+      {
+        // From the destructor this ends in std::terminate, before the memory of the contacts goes away
+        if (not detached)
+          throw std::logic_error("Logic error: allocator_pigeon destroyed while one of its messages is sending");
+      }
+  };
+
+  struct heap_policy
+    // A stateless allocation policy for basic_pigeon: 
+    // an empty type with static allocate and deallocate like pigeon::allocator
+  {
+    static void* allocate(size_t size_bytes, size_t alignment)
+    { 
+      return alignment > alignof(std::max_align_t) ? detail::aligned_new(size_bytes, alignment) 
+                                                   : ::operator new(size_bytes); 
+    }
+
+    static void deallocate(void* pointer, size_t, size_t alignment)
+    {
+      if (alignment > alignof(std::max_align_t))
+        detail::aligned_delete(pointer);
+      else
+        ::operator delete(pointer);
+    }
+  };
+
+  template <typename Policy>
+  class basic_pigeon: pigeon
+    // Every contact of this pigeon is allocated by Policy, unless deliver gets an allocator.
+    // The inboxes carry no allocator pointer and deallocate without a virtual call.
+    // For allocators with state use allocator_pigeon.
+  {
+      static_assert(std::is_empty<Policy>::value, "an allocation policy is stateless");
+
+      using base = pigeon;
+
+    public:
+      using policy_type = Policy;
+
+      using base::size;
+      using base::has_subscribers;
+      using base::clear;
+      using base::drop;
+
+      template <typename M, typename I, typename F = detail::noop>
+      contact_token deliver(M& message, I&& inbox, allocator* alloc = nullptr, F&& f = F{}, std::int16_t priority = 0) 
+      {
+        if (alloc)
+          return base::deliver(message, std::forward<I>(inbox), alloc, std::forward<F>(f), priority);
+        return deliver_contact(message, std::forward<I>(inbox), detail::policy<Policy>{}, std::forward<F>(f), priority);
+      }
+
+      template <typename M>
+      detail::deliver_proxy<M, basic_pigeon> deliver(M& message) 
+      {
+        return {*this, message};
+      }
   };
 } // namespace pigeon
 
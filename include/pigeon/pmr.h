@@ -0,0 +1,96 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/*
+pmr.h:
+Bridges between pigeon::allocator and std::pmr::memory_resource, needs C++17.
+memory_resource_allocator puts the inboxes into any memory resource,
+allocator_resource lets std::pmr containers use a pigeon allocator like the arenas.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <memory_resource>
+
+namespace pigeon 
+{
+  class memory_resource_allocator: public allocator
+    // The resource has to outlive the contacts allocated from it, 
+    // drop them before a monotonic resource releases its memory
+  {
+    public:
+      memory_resource_allocator():memory_resource_allocator{std::pmr::get_default_resource()} { }
+      explicit memory_resource_allocator(std::pmr::memory_resource* resource):Resource{resource} { }
+
+      void* allocate(size_t size_bytes, size_t alignment) override
+      {
+        auto pointer = Resource->allocate(size_bytes, alignment);
+        Used += size_bytes;
+        return pointer;
+      }
+
+      void deallocate(void* pointer, size_t size_bytes, size_t alignment) override
+      {
+        Used -= size_bytes;
+        Resource->deallocate(pointer, size_bytes, alignment);
+      }
+
+      std::pmr::memory_resource* resource() const { return Resource; }
+
+      size_t capacity() const { return Used; }  // the resource does not tell
+      size_t used    () const { return Used; }
+
+    private:
+      std::pmr::memory_resource* Resource;
+      size_t                     Used{0};
+  };
+
+  class allocator_resource: public std::pmr::memory_resource
+    // A memory_resource view of a pigeon allocator, the allocator has to outlive it
+  {
+    public:
+      explicit allocator_resource(allocator& alloc):Allocator{&alloc} { }
+
+      allocator& get_allocator() const { return *Allocator; }
+
+    private:
+      void* do_allocate(size_t size_bytes, size_t alignment) override 
+      { return Allocator->allocate(size_bytes, alignment); }
+
+      void do_deallocate(void* pointer, size_t size_bytes, size_t alignment) override
+      { Allocator->deallocate(pointer, size_bytes, alignment); }
+
+      bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override
+      {
+        auto resource = dynamic_cast<allocator_resource const*>(&other);
+        return resource and resource->Allocator == Allocator;
+      }
+
+      allocator* Allocator;
+  };
+}
@@ -0,0 +1,139 @@
+/*
+MIT License
+
+Copyright (c) 2025 Peter Neiss 
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+
+/*
+variant.h:
+variant_message sends a std::variant to the subscribers of its current alternative.
+Each alternative has its own message, send picks it by index() through a jump table.
+Needs C++17.
+*/
+
+#pragma once
+
+#include "pigeon.h"
+
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace pigeon 
+{
+  template <typename, typename = global_access, typename = list_storage> class variant_message;
+
+  template <typename ...Ts, typename S>
+  class variant_message<std::variant<Ts...>, protected_access, S>
+  {
+    public:
+      using variant_type = std::variant<Ts...>;
+
+      template <typename T>
+      using alternative_type = message<void(T const&), variant_message, S>;
+
+      template <typename T>
+      alternative_type<T>& alternative()
+        // The message for one alternative, deliver to it to subscribe
+      { 
+        static_assert((std::is_same_v<T, Ts> + ...) == 1, "T must be exactly one alternative of the variant");
+        return std::get<index_of<T>()>(Alternatives); 
+      }
+
+      bool isSending() const 
+      { return std::apply([](auto const& ...alternatives) { return (alternatives.isSending() or ...); }, Alternatives); }
+
+    protected:
+      size_t size() const 
+      { return std::apply([](auto const& ...alternatives) { return (alternatives.size() + ... + size_t{0}); }, Alternatives); }
+
+      bool has_subscribers() const
+      { return std::apply([](auto const& ...alternatives) { return (alternatives.has_subscribers() or ...); }, Alternatives); }
+
+      void clear()
+      { std::apply([](auto& ...alternatives) { (alternatives.clear(), ...); }, Alternatives); }
+
+      bool drop(contact_token token)
+      { return std::apply([token](auto& ...alternatives) { return (alternatives.drop(token) or ...); }, Alternatives); }
+
+      void send(variant_type const& value)
+        // Only the subscribers of the current alternative are touched
+      {
+        if (value.valueless_by_exception())
+          return;
+
+        send_alternative(value, std::index_sequence_for<Ts...>{});
+      }
+
+    private:
+      template <typename T>
+      static constexpr size_t index_of()
+      {
+        constexpr bool matches[] = { std::is_same_v<T, Ts>... };
+        size_t index{0};
+        while (not matches[index])
+          ++index;
+        return index;
+      }
+
+      template <size_t ...I>
+      void send_alternative(variant_type const& value, std::index_sequence<I...>)
+      {
+        using thunk = void (*)(variant_message&, variant_type const&);
+        static constexpr thunk table[] = { &send_alternative<I>... };
+        table[value.index()](*this, value);
+      }
+
+      template <size_t I>
+      static void send_alternative(variant_message& self, variant_type const& value)
+      { std::get<I>(self.Alternatives).send(*std::get_if<I>(&value)); }
+
+      std::tuple<alternative_type<Ts>...> Alternatives;
+  };
+
+  template <typename ...Ts, typename S>
+  struct variant_message<std::variant<Ts...>, global_access, S>: variant_message<std::variant<Ts...>, protected_access, S>
+  {
+    using base = variant_message<std::variant<Ts...>, protected_access, S>;
+    using base::size;
+    using base::has_subscribers;
+    using base::clear;
+    using base::drop;
+    using base::send;
+  };
+
+  template <typename ...Ts, typename F, typename S>
+  class variant_message<std::variant<Ts...>, F, S>: public variant_message<std::variant<Ts...>, protected_access, S>
+  { 
+    protected:
+      friend F;
+
+      using base = variant_message<std::variant<Ts...>, protected_access, S>;
+      using base::size;
+      using base::has_subscribers;
+      using base::clear;
+      using base::drop;
+      using base::send;
+  };
+}
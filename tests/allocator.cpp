@@ -0,0 +1,256 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/pigeon.h"
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+TEST_CASE("pool_allocator - size classes")
+{
+  pigeon::pool_allocator<> pool;
+  auto granularity = pigeon::pool_allocator<>::Granularity;
+
+  auto small  = pool.allocate(1, alignof(std::max_align_t));
+  auto medium = pool.allocate(3 * granularity, alignof(std::max_align_t));
+  CHECK(pool.used() == 4 * granularity);
+  CHECK(pool.heap_allocations() == 2);  // one chunk per size class
+  CHECK(reinterpret_cast<std::uintptr_t>(small)  % granularity == 0);
+  CHECK(reinterpret_cast<std::uintptr_t>(medium) % granularity == 0);
+
+  pool.deallocate(medium, 3 * granularity, alignof(std::max_align_t));
+  auto again = pool.allocate(3 * granularity - 1, alignof(std::max_align_t));  // same size class
+  CHECK(again == medium);
+  CHECK(pool.heap_allocations() == 2);
+
+  auto big = pool.allocate(pigeon::pool_allocator<>::MaxBlockSize + 1, alignof(std::max_align_t));
+  CHECK(pool.heap_allocations() == 3);
+  pool.deallocate(big, pigeon::pool_allocator<>::MaxBlockSize + 1, alignof(std::max_align_t));
+
+  pool.deallocate(again, 3 * granularity - 1, alignof(std::max_align_t));
+  pool.deallocate(small, 1, alignof(std::max_align_t));
+  CHECK(pool.used() == 0);
+  CHECK(pool.allocations()   == 4);
+  CHECK(pool.deallocations() == 4);
+}
+
+TEST_CASE("pool_allocator - churn reuses the memory")
+{
+  pigeon::allocator_pigeon<pigeon::pool_allocator<>> pigeon;
+  pigeon::message<void(int)> message;
+
+  int sum{0};
+  std::vector<pigeon::contact_token> tokens;
+  for (int count = 0; count < 100; ++count)
+    tokens.push_back(pigeon.deliver(message, [&sum](int value) { sum += value; }));
+
+  auto& pool = pigeon.get_allocator();
+  auto heapAllocations = pool.heap_allocations();
+  auto capacity        = pigeon.total_memory();
+  CHECK(pigeon.used_memory() > 0);
+  CHECK(pigeon.available_memory() < capacity);
+
+  for (int round = 0; round < 1000; ++round)
+  {
+    pigeon.drop(tokens[round % tokens.size()]);
+    tokens[round % tokens.size()] = pigeon.deliver(message, [&sum](int value) { sum += 2 * value; });
+  }
+
+  CHECK(pool.heap_allocations() == heapAllocations);
+  CHECK(pigeon.total_memory()   == capacity);
+  CHECK(pigeon.size() == 100);
+
+  message.send(1);
+  CHECK(sum == 200);
+
+  pigeon.clear();
+  CHECK(pigeon.used_memory() == 0);
+}
+
+TEST_CASE("arena allocators - exact fit")
+{
+  pigeon::arena_heap_allocator<4 * sizeof(void*)> heap;
+  CHECK(heap.allocate(3 * sizeof(void*), alignof(void*)) != nullptr);
+  CHECK(heap.allocate(sizeof(void*), alignof(void*)) != nullptr);
+  CHECK(heap.used() == heap.capacity());
+  CHECK_THROWS_AS(heap.allocate(1, 1), std::logic_error);
+  CHECK(heap.used() == heap.capacity());
+
+  pigeon::arena_stack_allocator<2 * sizeof(void*)> stack;
+  CHECK(stack.allocate(2 * sizeof(void*), alignof(void*)) != nullptr);
+  CHECK_THROWS_AS(stack.allocate(1, 1), std::logic_error);
+}
+
+TEST_CASE("arena_chunk_allocator - grows")
+{
+  pigeon::arena_chunk_allocator<64> arena;
+  CHECK(arena.capacity() == 0);
+
+  std::vector<void*> pointers;
+  for (int count = 0; count < 4; ++count)
+    pointers.push_back(arena.allocate(16, alignof(std::max_align_t)));
+  CHECK(arena.chunks() == 1);
+
+  pointers.push_back(arena.allocate(16, alignof(std::max_align_t)));
+  CHECK(arena.chunks() == 2);
+  CHECK(arena.capacity() == 64 + 128);
+
+  auto big = arena.allocate(1000, alignof(std::max_align_t));  // bigger than the next chunk
+  CHECK(arena.chunks() == 3);
+  CHECK(arena.capacity() == 64 + 128 + 1000);
+  CHECK(arena.used() == 5 * 16 + ((1000 + sizeof(void*) - 1) / sizeof(void*)) * sizeof(void*));
+
+  for (auto pointer: pointers)
+    CHECK(reinterpret_cast<std::uintptr_t>(pointer) % sizeof(void*) == 0);
+  CHECK(std::find(pointers.begin(), pointers.end(), big) == pointers.end());
+}
+
+TEST_CASE("arena_chunk_allocator - cap")
+{
+  pigeon::arena_chunk_allocator<64, 128> arena;
+  arena.allocate(64, alignof(std::max_align_t));
+  arena.allocate(48, alignof(std::max_align_t));  // the second chunk only gets the remaining 64 bytes
+  CHECK(arena.capacity() == 128);
+  CHECK_THROWS_AS(arena.allocate(32, alignof(std::max_align_t)), std::logic_error);
+  arena.allocate(16, alignof(std::max_align_t));
+  CHECK(arena.used() == 128);
+}
+
+TEST_CASE("arena_chunk_allocator - allocator_pigeon")
+{
+  pigeon::message<void(int)> message;
+  int sum{0};
+  {
+    pigeon::allocator_pigeon<pigeon::arena_chunk_allocator<256>> pigeon;
+    for (int count = 0; count < 100; ++count)
+      pigeon.deliver(message, [&sum](int value) { sum += value; });
+
+    CHECK(pigeon.get_allocator().chunks() > 1);
+    message.send(1);
+    CHECK(sum == 100);
+  }
+  CHECK(message.size() == 0);
+}
+
+TEST_CASE("allocators - alignment")
+{
+  struct alignas(64) cache_line { unsigned char Data[64]; };
+
+  auto aligned = [](const void* pointer) { return reinterpret_cast<std::uintptr_t>(pointer) % 64 == 0; };
+
+  pigeon::arena_heap_allocator<1024> heap;
+  heap.allocate(1, 1);
+  CHECK(aligned(heap.allocate(64, 64)));
+  CHECK(aligned(heap.allocate(8, 64)));
+
+  pigeon::arena_stack_allocator<1024> stack;
+  stack.allocate(1, 1);
+  CHECK(aligned(stack.allocate(64, 64)));
+
+  pigeon::arena_chunk_allocator<64> arena;
+  arena.allocate(8, 8);
+  CHECK(aligned(arena.allocate(64, 64)));  // does not fit, a new chunk
+  CHECK(aligned(arena.allocate(8, 64)));
+
+  pigeon::pool_allocator<> pool;
+  auto block = pool.allocate(64, 64);
+  CHECK(aligned(block));
+  pool.deallocate(block, 64, 64);
+  CHECK(pool.used() == 0);
+
+  SECTION("handlers with over-aligned state")
+  {
+    pigeon::allocator_pigeon<pigeon::arena_chunk_allocator<256>> pigeon;
+    pigeon::message<void()> message;
+
+    bool wasAligned{true};
+    for (int count = 0; count < 10; ++count)
+    {
+      cache_line state{};
+      pigeon.deliver(message, [state, &wasAligned, &aligned] { wasAligned = wasAligned and aligned(&state); });
+    }
+    message.send();
+    CHECK(wasAligned);
+  }
+}
+
+TEST_CASE("allocators - over-aligned handlers without an allocator")
+{
+  struct alignas(64) cache_line { unsigned char Data[64]; };
+
+  pigeon::pigeon pigeon;
+  pigeon::message<void()> message;
+
+  bool aligned{true};
+  cache_line state{};
+  pigeon.deliver(message, [state, &aligned] 
+    { aligned = reinterpret_cast<std::uintptr_t>(&state) % 64 == 0; });
+  message.send();
+  CHECK(aligned);
+}
+
+namespace
+{
+  struct counting_policy
+  {
+    static std::size_t Live;
+
+    static void* allocate(std::size_t size_bytes, std::size_t alignment)
+    { 
+      ++Live;
+      return pigeon::heap_policy::allocate(size_bytes, alignment); 
+    }
+
+    static void deallocate(void* pointer, std::size_t size_bytes, std::size_t alignment)
+    {
+      --Live;
+      pigeon::heap_policy::deallocate(pointer, size_bytes, alignment);
+    }
+  };
+
+  std::size_t counting_policy::Live{0};
+
+  auto policy_handler = [](int) { };
+  auto policy_drop    = [](pigeon::contact_token, pigeon::who) { };
+}
+
+static_assert(sizeof (pigeon::detail::inbox_with_policy<counting_policy, decltype(policy_handler), decltype(policy_drop), void, int>) == 
+              sizeof (pigeon::detail::inbox<decltype(policy_handler), decltype(policy_drop), void, int>),
+  "a stateless policy adds no storage to the inbox");
+
+TEST_CASE("basic_pigeon - allocation policy")
+{
+  pigeon::message<void(int)> message;
+  int sum{0};
+  {
+    pigeon::basic_pigeon<counting_policy> pigeon;
+    auto token = pigeon.deliver(message, [&sum](int value) { sum += value; });
+    pigeon.deliver(message).withPriority(1).to([&sum](int value) { sum = 10 * sum + value; });
+
+    bool dropped{false};
+    pigeon.deliver(message)
+      .onDrop([&dropped](pigeon::contact_token, pigeon::who) { dropped = true; })
+      .to([&sum](int value) { sum += value; });
+    CHECK(counting_policy::Live == 3);
+    CHECK(pigeon.size() == 3);
+
+    message.send(2);
+    CHECK(sum == 6);  // the priority handler went first, while sum was 0
+
+    pigeon.drop(token);
+    CHECK(counting_policy::Live == 2);
+
+    SECTION("an allocator still wins")
+    {
+      pigeon::pool_allocator<> pool;
+      pigeon.deliver(message).withAllocator(&pool).to([](int) { });
+      CHECK(counting_policy::Live == 2);
+      CHECK(pool.used() > 0);
+      pigeon.clear();
+      CHECK(pool.used() == 0);
+    }
+
+    message.clear();
+    CHECK(dropped);
+  }
+  CHECK(counting_policy::Live == 0);
+}
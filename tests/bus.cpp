@@ -0,0 +1,137 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/bus.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+TEST_CASE("bus - topics are hashed at compile time")
+{
+  constexpr pigeon::topic name{"sensors/kitchen/temperature"};
+  static_assert(name.size() == 27, "length of the literal");
+  static_assert(name.hash() == pigeon::detail::topic_hash("sensors/kitchen/temperature", 27), "constexpr hash");
+  CHECK(name.hash() == pigeon::topic{std::string("sensors/kitchen/temperature")}.hash());
+  CHECK(name.hash() != pigeon::topic{"sensors/kitchen/humidity"}.hash());
+}
+
+TEST_CASE("bus - publish and subscribe")
+{
+  pigeon::pigeon pigeon;
+  pigeon::bus<void(int)> bus;
+
+  std::vector<std::string> calls;
+  auto subscribe = [&](const char* pattern)
+    {
+      std::string name{pattern};
+      return bus.subscribe(pigeon, pigeon::topic{name}, [&calls, name](int) { calls.push_back(name); });
+    };
+
+  subscribe("a/b/c");
+  subscribe("a/+/c");
+  subscribe("a/#");
+  subscribe("#");
+  subscribe("a/b");
+  subscribe("+/+");
+
+  auto check = [&](const char* name, std::vector<std::string> expected)
+    {
+      calls.clear();
+      bus.publish(pigeon::topic{name, std::char_traits<char>::length(name)}, 1);
+      std::sort(calls.begin(), calls.end());
+      std::sort(expected.begin(), expected.end());
+      CHECK(calls == expected);
+    };
+
+  check("a/b/c", {"a/b/c", "a/+/c", "a/#", "#"});
+  check("a/x/c", {"a/+/c", "a/#", "#"});
+  check("a/b",   {"a/b", "+/+", "a/#", "#"});
+  check("a",     {"a/#", "#"});
+  check("b/c",   {"+/+", "#"});
+  check("b/c/d", {"#"});
+
+  SECTION("new subscriptions reach interned topics")
+  {
+    auto id = bus.intern("x/y");
+    CHECK(bus.has_subscribers(id));
+    subscribe("x/+");
+    calls.clear();
+    bus.publish(id, 1);
+    std::sort(calls.begin(), calls.end());
+    CHECK(calls == std::vector<std::string>{"#", "+/+", "x/+"});
+  }
+
+  SECTION("drop and clear")
+  {
+    auto token = subscribe("z");
+    check("z", {"z", "#"});
+    pigeon.drop(token);
+    check("z", {"#"});
+
+    auto id = bus.intern("z");
+    bus.clear();
+    CHECK_FALSE(bus.has_subscribers(id));
+    CHECK(pigeon.size() == 0);
+    check("a/b/c", {});
+  }
+}
+
+TEST_CASE("bus - interning")
+{
+  pigeon::bus<void(int)> bus;
+  auto first = bus.intern("a/b");
+  CHECK(bus.intern(std::string("a/b")) == first);
+  CHECK(bus.intern("a/c") != first);
+  CHECK(bus.topics() == 2);
+  CHECK_FALSE(bus.has_subscribers(first));
+
+  CHECK_THROWS_AS(bus.intern("a/+"), std::invalid_argument);
+  CHECK_THROWS_AS(bus.at("a/#/b"), std::invalid_argument);
+  CHECK(bus.topics() == 2);
+
+  SECTION("publishing by name interns nothing")
+  {
+    pigeon::pigeon pigeon;
+    int sum{0};
+    bus.subscribe(pigeon, "x/+", [&sum](int value) { sum += value; });
+
+    for (int index = 0; index < 100; ++index)
+      bus.publish(pigeon::topic{"y/" + std::to_string(index)}, 1);
+    CHECK(sum == 0);
+
+    bus.publish("x/1", 1);
+    bus.publish("a/b", 10);
+    CHECK(sum == 1);
+    CHECK(bus.topics() == 2);
+    CHECK_THROWS_AS(bus.publish("x/#", 1), std::invalid_argument);
+  }
+}
+
+TEST_CASE("bus - messages of a bus are ordinary messages")
+{
+  pigeon::pigeon pigeon;
+  pigeon::bus<int(int)> bus;
+
+  int sum{0};
+  pigeon.deliver(bus.at("n/+")).withPriority(1).to([&sum](int value) { sum = sum * 10 + value; return 0; });
+  pigeon.deliver(bus.at("n/+"), [&sum](int value) { sum = sum * 10 + 2 * value; return 0; });
+  bus.publish("n/1", 1);
+  CHECK(sum == 12);
+
+  SECTION("subscribe while publishing")
+  {
+    sum = 0;
+    bool subscribed{false};
+    pigeon.deliver(bus.at("m"), [&bus, &pigeon, &sum, &subscribed](int value) 
+      { 
+        sum += value;
+        if (not subscribed)
+          bus.subscribe(pigeon, "m/#", [&sum](int value) { sum += 100 * value; return 0; });
+        subscribed = true;
+        return 0; 
+      });
+    bus.publish("m", 1);
+    CHECK(sum == 1);
+    bus.publish("m", 1);
+    CHECK(sum == 1 + 1 + 100);
+  }
+}
@@ -0,0 +1,136 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/bytes.h"
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+  enum class kind: std::uint8_t { number, pair, text };
+
+  struct number { std::uint16_t Magic; kind Kind; std::uint32_t Value; };
+  struct pair   { std::uint16_t Magic; kind Kind; std::uint32_t First; std::uint32_t Second; };
+  struct text   { std::uint16_t Magic; kind Kind; char Text[13]; };
+
+  using dispatcher = pigeon::byte_dispatcher<pigeon::tag_field<kind, 2>, number, pair, text>;
+
+  template <typename T>
+  std::vector<unsigned char> bytes(T const& packet, size_t shift = 0)
+  {
+    std::vector<unsigned char> buffer(sizeof packet + shift);
+    std::memcpy(buffer.data() + shift, &packet, sizeof packet);
+    return buffer;
+  }
+}
+
+TEST_CASE("byte_dispatcher - typed delivery")
+{
+  pigeon::pigeon pigeon;
+  dispatcher dispatcher;
+
+  std::vector<std::uint32_t> numbers;
+  const void* seen{nullptr};
+  pigeon.deliver(dispatcher.payload<number>(), [&numbers, &seen](number const& packet) 
+    { 
+      numbers.push_back(packet.Value); 
+      seen = &packet;
+    });
+  pigeon.deliver(dispatcher.payload<pair>(), [&numbers](pair const& packet) 
+    { numbers.push_back(packet.First + packet.Second); });
+  CHECK(dispatcher.size() == 2);
+
+  alignas(number) unsigned char aligned[sizeof(number)];
+  number one{0xbeef, kind::number, 7};
+  std::memcpy(aligned, &one, sizeof one);
+
+  SECTION("aligned packets are not copied")
+  {
+    CHECK(dispatcher.dispatch(aligned, sizeof aligned));
+    CHECK(seen == aligned);
+    CHECK(numbers == std::vector<std::uint32_t>{7});
+    CHECK(dispatcher.copied() == 0);
+  }
+
+  SECTION("misaligned packets are copied")
+  {
+    auto buffer = bytes(pair{0xbeef, kind::pair, 1, 2}, 1);
+    CHECK(dispatcher.dispatch(buffer.data() + 1, sizeof(pair)));
+    CHECK(numbers == std::vector<std::uint32_t>{3});
+    CHECK(dispatcher.copied() == 1);
+  }
+
+  SECTION("containers with data and size")
+  {
+    auto buffer = bytes(number{0xbeef, kind::number, 9});
+    CHECK(dispatcher.dispatch(buffer));
+    CHECK(numbers == std::vector<std::uint32_t>{9});
+  }
+
+  SECTION("packets without subscribers are dispatched")
+  {
+    auto buffer = bytes(text{0xbeef, kind::text, "hello"});
+    CHECK(dispatcher.dispatch(buffer));
+    CHECK(dispatcher.dispatched() == 1);
+    CHECK(numbers.empty());
+  }
+
+  SECTION("rejected packets")
+  {
+    auto unknown = bytes(number{0xbeef, static_cast<kind>(3), 1});
+    CHECK_FALSE(dispatcher.dispatch(unknown));
+    CHECK_FALSE(dispatcher.dispatch(aligned, 2));                // no tag
+    CHECK_FALSE(dispatcher.dispatch(aligned, sizeof aligned - 1));  // too short for the payload
+    CHECK(dispatcher.rejected()   == 3);
+    CHECK(dispatcher.dispatched() == 0);
+    CHECK(numbers.empty());
+  }
+
+  SECTION("longer packets are fine")
+  {
+    auto buffer = bytes(number{0xbeef, kind::number, 5});
+    buffer.resize(buffer.size() + 10);
+    CHECK(dispatcher.dispatch(buffer));
+    CHECK(numbers == std::vector<std::uint32_t>{5});
+  }
+}
+
+TEST_CASE("byte_dispatcher - integer tags")
+{
+  struct first  { std::uint32_t Tag; std::uint32_t Value; };
+  struct second { std::uint32_t Tag; double Value; };
+
+  pigeon::pigeon pigeon;
+  pigeon::byte_dispatcher<pigeon::tag_field<std::uint32_t>, first, second> dispatcher;
+
+  double sum{0};
+  pigeon.deliver(dispatcher.payload<first >(), [&sum](first  const& packet) { sum += packet.Value; });
+  pigeon.deliver(dispatcher.payload<second>(), [&sum](second const& packet) { sum += packet.Value; });
+
+  first  one{0, 2};
+  second two{1, 0.5};
+  dispatcher.dispatch(&one, sizeof one);
+  dispatcher.dispatch(&two, sizeof two);
+  CHECK(sum == 2.5);
+}
+
+TEST_CASE("byte_dispatcher - payloads without default constructor")
+{
+  struct packet 
+  { 
+    packet(std::uint32_t tag, std::uint32_t value):Tag{tag}, Value{value} { }
+    std::uint32_t Tag; 
+    std::uint32_t Value; 
+  };
+
+  pigeon::pigeon pigeon;
+  pigeon::byte_dispatcher<pigeon::tag_field<std::uint32_t>, packet> dispatcher;
+
+  std::uint32_t value{0};
+  pigeon.deliver(dispatcher.payload<packet>(), [&value](packet const& p) { value = p.Value; });
+
+  alignas(packet) unsigned char buffer[sizeof(packet) + 1];
+  packet original{0, 7};
+  std::memcpy(buffer + 1, &original, sizeof original);
+  dispatcher.dispatch(buffer + 1, sizeof original);  // misaligned, copied
+  CHECK(value == 7);
+}
@@ -0,0 +1,276 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/concurrent.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+TEST_CASE("concurrent_message - deliver, drop and clear")
+{
+  pigeon::concurrent_message<void(int)> message;
+  CHECK_FALSE(message.has_subscribers());
+
+  int sum{0};
+  pigeon::contact_token stale;
+  {
+    pigeon::pigeon pigeon;
+    auto first = pigeon.deliver(message, [&sum](int value) { sum += value; });
+    stale = pigeon.deliver(message, [&sum](int value) { sum += 10 * value; });
+    CHECK(message.size() == 2);
+    CHECK(pigeon.size()  == 2);
+
+    message.send(1);
+    CHECK(sum == 11);
+
+    pigeon.drop(first);
+    CHECK(message.size() == 1);
+    message.send(1);
+    CHECK(sum == 21);
+
+    CHECK_FALSE(message.drop(first));
+  }
+  CHECK_FALSE(message.has_subscribers());
+  CHECK_FALSE(message.drop(stale));  // the pigeon of the token is gone
+
+  {
+    pigeon::pigeon successor;  // reuses the table of the destroyed pigeon
+    successor.deliver(message, [&sum](int value) { sum += value; });
+    successor.deliver(message, [&sum](int value) { sum += value; });
+    CHECK_FALSE(message.drop(stale));
+    CHECK(message.size() == 2);
+  }
+
+  pigeon::pigeon pigeon;
+  std::vector<pigeon::who> dropped;
+  auto onDrop = [&dropped](pigeon::contact_token, pigeon::who w) { dropped.push_back(w); };
+  auto token = pigeon.deliver(message, [&sum](int value) { sum += value; }, nullptr, onDrop);
+  pigeon.deliver(message, [&sum](int value) { sum += value; }, nullptr, onDrop);
+  pigeon.deliver(message, [&sum](int value) { sum += value; }, nullptr, onDrop);
+
+  CHECK(message.drop(token));
+  CHECK(pigeon.size() == 2);
+  message.clear();
+  CHECK(pigeon.size() == 0);
+  CHECK(dropped == std::vector<pigeon::who>(3, pigeon::who::message));
+}
+
+TEST_CASE("concurrent_message - iteration_state")
+{
+  pigeon::pigeon pigeon;
+  pigeon::concurrent_message<int()> message;
+
+  std::vector<int> calls;
+  for (int count = 1; count <= 5; ++count)
+    pigeon.deliver(message, [&calls, count] { calls.push_back(count); return count; });
+
+  SECTION("finish")
+  {
+    message.response([](int value) 
+      { return value == 3 ? pigeon::iteration_state::finish : pigeon::iteration_state::progress; });
+    CHECK(calls == std::vector<int>{5, 4, 3});
+  }
+
+  SECTION("repeat")
+  {
+    bool repeated{false};
+    message.response([&repeated](int value) 
+      { 
+        if (value == 3 and not repeated)
+        {
+          repeated = true;
+          return pigeon::iteration_state::repeat; 
+        }
+        return pigeon::iteration_state::progress; 
+      });
+    CHECK(calls == std::vector<int>{5, 4, 3, 2, 1, 5, 4});
+
+    // the order of later sends stays as it is
+    calls.clear();
+    message.send();
+    CHECK(calls == std::vector<int>{5, 4, 3, 2, 1});
+  }
+}
+
+TEST_CASE("concurrent_message - deliver and drop inside a handler")
+{
+  pigeon::pigeon pigeon;
+  pigeon::concurrent_message<void()> message;
+
+  int calls{0};
+  pigeon::contact_token self;
+  self = pigeon.deliver(message, [&] 
+    { 
+      ++calls;
+      pigeon.drop(self); 
+      pigeon.deliver(message, [&calls] { ++calls; });
+    });
+
+  message.send();
+  CHECK(calls == 1);
+  CHECK(message.size() == 1);
+
+  message.send();
+  CHECK(calls == 2);
+}
+
+TEST_CASE("concurrent_message - a handler drops another one")
+{
+  pigeon::pigeon pigeon;
+  pigeon::concurrent_message<void()> message;
+
+  int calls{0};
+  auto victim = pigeon.deliver(message, [&calls] { ++calls; });
+  pigeon.deliver(message, [&] { pigeon.drop(victim); });  // sent first
+
+  message.send();
+  CHECK(calls == 0);  // like message, a handler dropped earlier in the send does not run
+  CHECK(message.size() == 1);
+
+  message.send();
+  CHECK(calls == 0);
+}
+
+TEST_CASE("concurrent_message - drop waits for running handlers")
+{
+  pigeon::concurrent_message<void()> message;
+  std::atomic<bool> started{false};
+  std::atomic<bool> finished{false};
+
+  pigeon::pigeon pigeon;
+  auto token = pigeon.deliver(message, [&started, &finished]
+    {
+      started = true;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      finished = true;
+    });
+
+  std::thread sender{[&message] { message.send(); }};
+  while (not started)
+    std::this_thread::yield();
+
+  pigeon.drop(token);
+  CHECK(finished);
+  sender.join();
+}
+
+TEST_CASE("concurrent_message - deliver does not wait for running handlers")
+{
+  pigeon::concurrent_message<void()> message;
+  std::atomic<bool> started {false};
+  std::atomic<bool> released{false};
+
+  pigeon::pigeon pigeon;
+  pigeon.deliver(message, [&started, &released]
+    {
+      started = true;
+      while (not released)
+        std::this_thread::yield();
+    });
+
+  std::thread sender{[&message] { message.send(); }};
+  while (not started)
+    std::this_thread::yield();
+
+  int calls{0};
+  pigeon.deliver(message, [&calls] { ++calls; });  // would wait forever for the handler
+  released = true;
+  sender.join();
+
+  message.send();
+  CHECK(calls == 1);
+}
+
+TEST_CASE("concurrent_message - drop inside handlers of two messages does not wait")
+{
+  pigeon::concurrent_message<void()> first;
+  pigeon::concurrent_message<void()> second;
+  std::atomic<int> inside{0};
+  auto meet = [&inside]
+  {
+    ++inside;
+    while (inside < 2)
+      std::this_thread::yield();
+  };
+
+  pigeon::pigeon firstPigeon;
+  pigeon::pigeon secondPigeon;
+  auto onSecond = firstPigeon .deliver(second, []{});
+  auto onFirst  = secondPigeon.deliver(first,  []{});
+  firstPigeon .deliver(first,  [&] { meet(); firstPigeon .drop(onSecond); });
+  secondPigeon.deliver(second, [&] { meet(); secondPigeon.drop(onFirst);  });
+
+  // Each drop would wait for the send of the other thread, which waits for this one
+  std::thread firstSender {[&first]  { first .send(); }};
+  std::thread secondSender{[&second] { second.send(); }};
+  firstSender .join();
+  secondSender.join();
+
+  CHECK(first .size() == 1);
+  CHECK(second.size() == 1);
+}
+
+TEST_CASE("concurrent_message - send from several threads while delivering and dropping")
+{
+  pigeon::concurrent_message<void(int)> message;
+  std::atomic<long> stable{0};
+  std::atomic<long> churn {0};
+
+  pigeon::pigeon pigeon;
+  pigeon.deliver(message, [&stable](int value) { stable += value; });
+
+  const int Threads = 4;
+  const int Sends   = 5000;
+  std::vector<std::thread> senders;
+  for (int thread = 0; thread < Threads; ++thread)
+    senders.emplace_back([&message] 
+      { 
+        for (int count = 0; count < Sends; ++count) 
+          message.send(1); 
+      });
+
+  {
+    pigeon::pigeon churner;
+    for (int count = 0; count < 500; ++count)
+    {
+      auto token = churner.deliver(message, [&churn](int value) { churn += value; });
+      if (count % 2)
+        churner.drop(token);
+    }
+  }
+
+  for (auto& sender: senders)
+    sender.join();
+
+  CHECK(stable == Threads * Sends);
+  CHECK(message.size() == 1);
+}
+
+TEST_CASE("concurrent_message - priorities")
+{
+  pigeon::pigeon pigeon;
+  pigeon::concurrent_message<void()> message;
+
+  std::vector<int> calls;
+  pigeon.deliver(message).withPriority(0).to([&calls] { calls.push_back(1); });
+  pigeon.deliver(message).withPriority(5).to([&calls] { calls.push_back(2); });
+  pigeon.deliver(message).withPriority(-1).to([&calls] { calls.push_back(3); });
+  pigeon.deliver(message).withPriority(5).to([&calls] { calls.push_back(4); });
+  pigeon.deliver(message, [&calls] { calls.push_back(5); });
+
+  message.send();
+  CHECK(calls == std::vector<int>{4, 2, 5, 1, 3});
+}
+
+TEST_CASE("concurrent_message - basic_pigeon")
+{
+  pigeon::concurrent_message<void(int)> message;
+  int sum{0};
+  {
+    pigeon::basic_pigeon<pigeon::heap_policy> pigeon;
+    pigeon.deliver(message, [&sum](int value) { sum += value; });
+    message.send(3);
+  }
+  CHECK(sum == 3);
+  CHECK(message.size() == 0);
+}
@@ -0,0 +1,141 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/conflating.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+TEST_CASE("conflating_message - latest value wins")
+{
+  pigeon::pigeon pigeon;
+  pigeon::conflating_message<std::string, int> message;
+  CHECK_FALSE(message.has_subscribers());
+
+  std::vector<std::pair<std::string, int>> calls;
+  auto token = pigeon.deliver(message.flushed(), [&calls](std::string const& key, int const& value) { calls.emplace_back(key, value); });
+  CHECK(message.size() == 1);
+  CHECK(message.has_subscribers());
+
+  message.update("b", 1);
+  message.update("a", 2);
+  message.update("b", 3);
+  CHECK(message.pending() == 2);
+  CHECK(calls.empty());
+
+  CHECK(message.flush() == 2);
+  CHECK(message.pending() == 0);
+  CHECK(calls == std::vector<std::pair<std::string, int>>{{"b", 3}, {"a", 2}});
+
+  CHECK(message.flush() == 0);
+  CHECK(message.stats().Updates   == 3);
+  CHECK(message.stats().Conflated == 1);
+  CHECK(message.stats().Flushed   == 2);
+  CHECK(message.stats().Flushes   == 1);
+
+  SECTION("discard")
+  {
+    message.update("c", 4);
+    message.discard();
+    calls.clear();
+    CHECK(message.flush() == 0);
+    CHECK(calls.empty());
+  }
+
+  SECTION("drop")
+  {
+    CHECK(message.drop(token));
+    CHECK_FALSE(message.drop(token));
+    message.update("c", 4);
+    CHECK(message.flush() == 1);
+    CHECK(calls.size() == 2);
+  }
+
+  SECTION("reset_stats")
+  {
+    message.reset_stats();
+    CHECK(message.stats().Updates == 0);
+    CHECK(message.stats().Flushes == 0);
+  }
+}
+
+TEST_CASE("conflating_message - burst")
+{
+  pigeon::pigeon pigeon;
+  pigeon::conflating_message<int, long> message;
+
+  std::vector<long> latest(1000, -1);
+  int calls{0};
+  pigeon.deliver(message.flushed(), [&](int const& key, long const& value) { ++calls; latest[key] = value; });
+
+  for (long update = 0; update < 1000000; ++update)
+    message.update(int(update % 1000), update);
+
+  CHECK(message.flush() == 1000);
+  CHECK(calls == 1000);
+  CHECK(latest[0]   == 999000);
+  CHECK(latest[999] == 999999);
+  CHECK(message.stats().Conflated == 999000);
+}
+
+TEST_CASE("conflating_message - updates while flushing")
+{
+  pigeon::pigeon pigeon;
+  pigeon::conflating_message<int, int> message;
+
+  std::vector<int> calls;
+  pigeon.deliver(message.flushed(), [&](int const& key, int const& value) 
+    { 
+      calls.push_back(value); 
+      CHECK(message.isSending());
+      CHECK(message.flush() == 0);
+      CHECK_THROWS_AS(message.discard(), std::logic_error);
+      if (key == 1)
+        message.update(1, value + 1);
+    });
+
+  message.update(1, 1);
+  message.update(2, 1);
+  CHECK(message.flush() == 2);
+  CHECK_FALSE(message.isSending());
+  CHECK(message.pending() == 1);
+  CHECK(message.flush() == 1);
+  CHECK(calls == std::vector<int>{1, 1, 2});
+}
+
+TEST_CASE("conflating_message - throwing handler")
+{
+  pigeon::pigeon pigeon;
+  pigeon::conflating_message<int, int> message;
+
+  pigeon.deliver(message.flushed(), [](int const&, int const&) { throw 1; });
+  message.update(1, 1);
+  message.update(2, 2);
+  CHECK_THROWS(message.flush());
+  CHECK_FALSE(message.isSending());
+  CHECK(message.pending() == 0);
+
+  message.update(1, 1);
+  CHECK(message.pending() == 1);
+}
+
+namespace
+{
+  struct Feed
+  {
+    pigeon::conflating_message<int, double, Feed> Message;
+    void update(int key, double value) { Message.update(key, value); }
+    size_t flush() { return Message.flush(); }
+  };
+}
+
+TEST_CASE("conflating_message - friend access")
+{
+  pigeon::pigeon pigeon;
+  Feed feed;
+
+  double sum{0};
+  pigeon.deliver(feed.Message.flushed(), [&sum](int const&, double const& value) { sum += value; });
+  feed.update(1, 1.5);
+  feed.update(1, 2.5);
+  CHECK(feed.flush() == 1);
+  CHECK(sum == 2.5);
+}
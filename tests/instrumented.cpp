@@ -0,0 +1,51 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/instrumented.h"
+#include <vector>
+
+TEST_CASE("instrumented_allocator - counts")
+{
+  pigeon::instrumented_allocator<pigeon::arena_heap_allocator<4096>> arena;
+  arena.allocate(1, 1);
+  arena.allocate(64, 64);
+  arena.allocate(8, 8);
+  CHECK(arena.live_allocations() == 3);
+  CHECK(arena.live_bytes() == 73);
+  CHECK(arena.wasted_bytes() == arena.used() - 73);
+  CHECK(arena.wasted_bytes() > 0);
+  CHECK(arena.by_size().size() == 3);
+}
+
+TEST_CASE("instrumented_allocator - allocator_pigeon")
+{
+  pigeon::allocator_pigeon<pigeon::instrumented_allocator<pigeon::pool_allocator<>>> pigeon;
+  pigeon::message<void(int)> message;
+  auto& stats = pigeon.get_allocator();
+
+  int sum{0};
+  char big[100] = {};
+  std::vector<pigeon::contact_token> tokens;
+  for (int count = 0; count < 10; ++count)
+    tokens.push_back(pigeon.deliver(message, [&sum](int value) { sum += value; }));
+  tokens.push_back(pigeon.deliver(message, [&sum, big](int value) { sum += value + big[0]; }));
+
+  CHECK(stats.live_allocations() == 11);
+  CHECK(stats.by_size().size() == 2);  // two handler types
+  auto peak = stats.peak_bytes();
+  CHECK(peak == stats.live_bytes());
+
+  for (int count = 0; count < 5; ++count)
+    pigeon.drop(tokens[count]);
+  CHECK(stats.live_allocations() == 6);
+  CHECK(stats.peak_bytes() == peak);
+  CHECK(stats.live_bytes() < peak);
+
+  for (auto& size: stats.by_size())
+  {
+    CHECK(size.Live <= size.Peak);
+    CHECK(size.Peak <= size.Total);
+  }
+
+  pigeon.clear();
+  CHECK(stats.live_allocations() == 0);
+  CHECK(stats.total_allocations() == 11);
+}
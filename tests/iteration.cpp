@@ -1,7 +1,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include "pigeon/pigeon.h"
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <vector>
 
 TEST_CASE("Single Pigeon - Single Message")
 {
@@ -216,3 +218,144 @@ TEST_CASE("change during iteration")
   CHECK_FALSE(obj.OnChange.isSending());
 }
 
+
+TEST_CASE("deferred change during iteration")
+{
+  pigeon::pigeon pigeon;
+
+  class Modifiable
+  {
+    public:
+      pigeon::message<void(Modifiable&, pigeon::value_state&), pigeon::global_access, pigeon::deferred_storage<1>> OnChange;
+
+      int get() { return Value; }
+      void set(int value) 
+      { 
+        Value = value;  
+        pigeon::value_state state;
+        OnChange.send(*this, state);
+      }
+
+    private:
+      int Value;
+  };
+
+  Modifiable obj;
+  std::vector<int> seen;
+
+  pigeon.deliver(obj.OnChange, 
+    [&] (Modifiable& mod, pigeon::value_state& state) 
+    {
+      CHECK(mod.OnChange.isSending());
+      seen.push_back(mod.get());
+      if (mod.get() != 42)
+      {
+        mod.set(42);  // Replayed after the outer send
+        CHECK(seen.size() == 1);
+      }
+      state = pigeon::value_state::changed;
+    }
+  );
+
+  obj.set(1);
+  CHECK_FALSE(obj.OnChange.isSending());
+  CHECK(seen == std::vector<int>{1, 42});
+}
+
+TEST_CASE("deferred sends")
+{
+  pigeon::pigeon pigeon;
+
+  SECTION("in order without recursion")
+  {
+    pigeon::message<void(int), pigeon::global_access, pigeon::deferred_storage<1>> message;
+    std::vector<int> seen;
+    int depth{0};
+    int maxDepth{0};
+    pigeon.deliver(message, [&](int value) 
+      { 
+        maxDepth = std::max(maxDepth, ++depth);
+        seen.push_back(value);
+        if (value < 1000)
+          message.send(value + 1);
+        --depth;
+      });
+
+    message.send(1);
+    CHECK(seen.size() == 1000);
+    CHECK(seen.back() == 1000);
+    CHECK(std::is_sorted(seen.begin(), seen.end()));
+    CHECK(maxDepth == 1);
+  }
+
+  SECTION("arguments are kept")
+  {
+    pigeon::message<void(std::string const&, std::string), pigeon::global_access, pigeon::deferred_storage<2>> message;
+    std::vector<std::string> seen;
+    pigeon.deliver(message, [&](std::string const& first, std::string second) 
+      { 
+        seen.push_back(first + second);
+        if (seen.size() == 1)
+        {
+          message.send(std::string(40, 'a'), std::string(40, 'b'));
+          message.send("c", "d");
+        }
+      });
+
+    message.send("x", "y");
+    CHECK(seen == std::vector<std::string>{"xy", std::string(40, 'a') + std::string(40, 'b'), "cd"});
+  }
+
+  SECTION("full queue")
+  {
+    pigeon::message<void(int), pigeon::global_access, pigeon::deferred_storage<1>> message;
+    int calls{0};
+    pigeon.deliver(message, [&](int value) 
+      { 
+        ++calls;
+        if (value == 0)
+        {
+          message.send(1);
+          message.send(2);
+        }
+      });
+
+    CHECK_THROWS_AS(message.send(0), std::logic_error);
+    CHECK_FALSE(message.isSending());
+    CHECK(calls == 1);
+
+    message.send(3);  // the left over send is gone
+    CHECK(calls == 2);
+  }
+
+  SECTION("responses stay ignored")
+  {
+    pigeon::message<void(int), pigeon::global_access, pigeon::deferred_storage<1>> message;
+    int calls{0};
+    pigeon.deliver(message, [&](int value) 
+      { 
+        ++calls;
+        if (value == 0)
+          message.response(1, [] { return pigeon::iteration_state::progress; });
+      });
+
+    message.send(0);
+    CHECK(calls == 1);
+  }
+
+  SECTION("send_batch")
+  {
+    pigeon::message<void(int), pigeon::global_access, pigeon::deferred_storage<4, pigeon::array_storage>> message;
+    std::vector<int> seen;
+    pigeon.deliver(message, [&](int value) 
+      { 
+        seen.push_back(value);
+        if (value < 10)
+          message.send(value + 10);
+      });
+
+    std::vector<int> const events{1, 2};
+    message.send_batch(events);
+    CHECK(seen == std::vector<int>{1, 2, 11, 12});
+  }
+}
@@ -0,0 +1,154 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/mailbox.h"
+#include "pigeon/concurrent.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("mailbox_pigeon - handlers run when pumped")
+{
+  pigeon::message<void(int, std::string)> message;
+  pigeon::mailbox_pigeon pigeon;
+
+  std::vector<std::string> calls;
+  pigeon.deliver(message, [&calls](int value, std::string const& text) 
+    { calls.push_back(std::to_string(value) + text); });
+  CHECK(pigeon.size() == 1);
+
+  std::string text{"a long string, too long for the small string optimization"};
+  message.send(1, text);
+  message.send(2, "b");
+  CHECK(calls.empty());
+  CHECK_FALSE(pigeon.inbox().empty());
+
+  CHECK(pigeon.pump(1) == 1);
+  CHECK(calls == std::vector<std::string>{"1" + text});
+  CHECK(pigeon.pump() == 1);
+  CHECK(calls == std::vector<std::string>{"1" + text, "2b"});
+  CHECK(pigeon.pump() == 0);
+  CHECK(pigeon.inbox().empty());
+}
+
+TEST_CASE("mailbox_pigeon - mail for a dropped handler is discarded")
+{
+  pigeon::message<void(int)> message;
+  pigeon::mailbox_pigeon pigeon;
+
+  int sum{0};
+  auto token = pigeon.deliver(message, [&sum](int value) { sum += value; });
+  pigeon.deliver(message, [&sum](int value) { sum += 10 * value; });
+
+  message.send(1);
+  pigeon.drop(token);
+  CHECK(pigeon.pump() == 2);
+  CHECK(sum == 10);
+
+  SECTION("pending mail when the pigeon goes away")
+  {
+    pigeon::mailbox_pigeon other;
+    other.deliver(message, [&sum](int value) { sum += 100 * value; });
+    message.send(1);
+  }
+  CHECK(sum == 10);
+}
+
+TEST_CASE("mailbox_pigeon - big arguments")
+{
+  struct big { char Data[4 * pigeon::mailbox::MailSize]; };
+  pigeon::message<void(big const&)> message;
+  pigeon::mailbox_pigeon pigeon;
+
+  char first{0};
+  pigeon.deliver(message, [&first](big const& b) { first = b.Data[0]; });
+
+  big b{};
+  b.Data[0] = 'x';
+  message.send(b);
+  b.Data[0] = 'y';
+  pigeon.pump();
+  CHECK(first == 'x');
+}
+
+TEST_CASE("mailbox_pigeon - backpressure reject")
+{
+  pigeon::message<void(int)> message;
+  pigeon::mailbox_pigeon pigeon{4, pigeon::backpressure::reject};
+
+  int sum{0};
+  pigeon.deliver(message, [&sum](int value) { sum += value; });
+  for (int count = 0; count < 10; ++count)
+    message.send(1);
+
+  CHECK(pigeon.inbox().capacity() == 4);
+  CHECK(pigeon.inbox().rejected() == 6);
+  CHECK(pigeon.pump() == 4);
+  CHECK(sum == 4);
+}
+
+TEST_CASE("mailbox_pigeon - handlers posting to their own mailbox")
+{
+  pigeon::message<void(int)> message;
+  pigeon::mailbox_pigeon pigeon{2, pigeon::backpressure::block};
+
+  int calls{0};
+  pigeon.deliver(message, [&message, &calls](int value) 
+    { 
+      ++calls;
+      if (value > 0)
+      {
+        message.send(value - 1);  // takes the cell of the running mail
+        message.send(value - 1);  // the ring is full, the pumping thread can not wait for itself
+      }
+    });
+
+  message.send(3);
+  message.send(0);
+  CHECK(pigeon.pump(5) == 5);
+  CHECK(pigeon.inbox().rejected() == 3);
+  CHECK(calls == 5);
+}
+
+TEST_CASE("mailbox_pigeon - wait")
+{
+  pigeon::message<void()> message;
+  pigeon::mailbox_pigeon pigeon;
+  pigeon.deliver(message, [] { });
+
+  CHECK_FALSE(pigeon.wait(std::chrono::milliseconds(1)));
+  message.send();
+  CHECK(pigeon.wait(std::chrono::milliseconds(0)));
+}
+
+TEST_CASE("mailbox_pigeon - several sending threads")
+{
+  const int Threads = 4;
+  const int Sends   = 20000;
+
+  pigeon::concurrent_message<void(int)> message;
+  pigeon::mailbox_pigeon pigeon{64};
+
+  long sum{0};
+  long count{0};
+  pigeon.deliver(message, [&sum, &count](int value) { sum += value; ++count; });
+
+  std::vector<std::thread> senders;
+  for (int thread = 0; thread < Threads; ++thread)
+    senders.emplace_back([&message] 
+      { 
+        for (int value = 1; value <= Sends; ++value) 
+          message.send(value); 
+      });
+
+  while (count < Threads * Sends)
+    if (pigeon.wait(std::chrono::milliseconds(100)))
+      pigeon.pump(16);
+
+  for (auto& sender: senders)
+    sender.join();
+
+  CHECK(sum == Threads * (long{Sends} * (Sends + 1) / 2));
+  CHECK(pigeon.inbox().rejected() == 0);
+}
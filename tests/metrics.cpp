@@ -0,0 +1,94 @@
+#define PIGEON_METRICS 1
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/pigeon.h"
+#include <sstream>
+#include <string>
+
+TEST_CASE("metrics - counting")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<int(int)> message;
+  message.metrics().name("numbers");
+
+  pigeon.deliver(message, [](int value) { return value; });
+  pigeon.deliver(message, [&message](int value) { message.send(value); return value; });  // reentrant
+  pigeon.deliver(message, [](int value) { return value; });
+
+  message.send(1);
+  auto& metrics = message.metrics();
+  CHECK(metrics.sends() == 1);
+  CHECK(metrics.invocations() == 3);
+  CHECK(metrics.ignored_reentrant() == 1);
+  CHECK(metrics.peak_subscribers() == 3);
+
+  message.response(2, [](int value) { return value == 2 ? pigeon::iteration_state::finish : pigeon::iteration_state::progress; });
+  CHECK(metrics.sends() == 2);
+  CHECK(metrics.invocations() == 4);
+  CHECK(metrics.finishes() == 1);
+
+  bool repeated{false};
+  message.response(3, [&repeated](int) 
+    { 
+      auto state = repeated ? pigeon::iteration_state::progress : pigeon::iteration_state::repeat;
+      repeated = true;
+      return state;
+    });
+  CHECK(metrics.repeats() == 1);
+
+  SECTION("dead senders")
+  {
+    pigeon::pigeon other;
+    pigeon::contact_token token;
+    token = other.deliver(message, [](int value) { return value; });
+    other.deliver(message, [&other, &token](int value) { other.drop(token); return value; });  // sent before
+
+    auto invocations = metrics.invocations();
+    message.send(4);
+    CHECK(metrics.reaped() == 1);
+    CHECK(metrics.invocations() == invocations + 4);  // not the dropped one
+
+    message.response(4, [](int) { return pigeon::iteration_state::dead; });
+    CHECK(metrics.reaped() == 5);
+    CHECK(message.size() == 0);
+  }
+
+  SECTION("subscriber history")
+  {
+    pigeon.clear();
+    message.send(5);
+    REQUIRE(metrics.history_size() == 4);
+    CHECK(metrics.history(0) == 3);
+    CHECK(metrics.history(3) == 0);
+  }
+}
+
+TEST_CASE("metrics - registry")
+{
+  pigeon::message<void()> first;
+  first.metrics().name("first");
+  size_t count{0};
+  {
+    pigeon::message<void()> second;
+    pigeon::metrics_registry::for_each([&count](pigeon::message_metrics const&) { ++count; });
+  }
+  size_t after{0};
+  pigeon::metrics_registry::for_each([&after](pigeon::message_metrics const&) { ++after; });
+  CHECK(after == count - 1);
+
+  first.send();
+  std::ostringstream out;
+  pigeon::metrics_registry::export_text(out);
+  CHECK(out.str().find("first sends=1 ") != std::string::npos);
+}
+
+TEST_CASE("metrics - send_batch")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(int)> message;
+  pigeon.deliver(message, [](int) { });
+
+  int events[] = {1, 2, 3};
+  message.send_batch(pigeon::batch_view<int>{events, 3});
+  CHECK(message.metrics().sends() == 1);
+  CHECK(message.metrics().invocations() == 1);
+}
@@ -0,0 +1,157 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/parallel.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+TEST_CASE("thread_pool - parallel_for")
+{
+  pigeon::thread_pool pool{3};
+  CHECK(pool.size() == 3);
+
+  std::vector<std::atomic<int>> calls(1000);
+  for (auto& call: calls)
+    call = 0;
+
+  pool.parallel_for(calls.size(), [&calls](size_t index) { ++calls[index]; });
+  for (auto& call: calls)
+    CHECK(call == 1);
+
+  SECTION("nothing to do")
+  {
+    bool meanwhile{false};
+    pool.parallel_for(0, [](size_t) { }, [&meanwhile] { meanwhile = true; });
+    CHECK(meanwhile);
+  }
+
+  SECTION("exceptions")
+  {
+    std::atomic<int> count{0};
+    CHECK_THROWS_AS(pool.parallel_for(100, [&count](size_t index) 
+      { 
+        ++count;
+        if (index == 42) 
+          throw std::runtime_error("42"); 
+      }), std::runtime_error);
+    CHECK(count == 100);
+  }
+
+  SECTION("nested")
+  {
+    std::atomic<int> count{0};
+    pool.parallel_for(10, [&pool, &count](size_t) 
+      { 
+        pool.parallel_for(10, [&count](size_t) { ++count; }); 
+      });
+    CHECK(count == 100);
+  }
+}
+
+TEST_CASE("parallel_send - thread_safe handlers run on the pool")
+{
+  pigeon::thread_pool pool{4};
+  pigeon::pigeon pigeon;
+  pigeon::message<void(std::string const&)> message;
+
+  std::mutex mutex;
+  std::set<std::thread::id> threads;
+  std::vector<std::string> texts;
+  std::atomic<int> calls{0};
+  for (int count = 0; count < 16; ++count)
+    pigeon.deliver(message, pigeon::thread_safe([&](std::string const& text)
+      {
+        // no CHECK here, Catch2 assertions are not thread safe
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        std::lock_guard<std::mutex> lock{mutex};
+        threads.insert(std::this_thread::get_id());
+        texts.push_back(text);
+        ++calls;
+      }));
+
+  std::vector<std::thread::id> unsafe;
+  pigeon.deliver(message, [&unsafe](std::string const&) { unsafe.push_back(std::this_thread::get_id()); });
+
+  pigeon::parallel_send(pool, message, "hello");
+  CHECK(calls == 16);
+  CHECK(texts == std::vector<std::string>(16, "hello"));
+  CHECK(threads.size() > 1);
+  CHECK(unsafe == std::vector<std::thread::id>{std::this_thread::get_id()});
+}
+
+TEST_CASE("parallel_response - results and iteration_state")
+{
+  pigeon::thread_pool pool{2};
+  pigeon::pigeon pigeon;
+  pigeon::message<int(int)> message;
+
+  std::atomic<int> calls{0};
+  for (int count = 1; count <= 5; ++count)
+    pigeon.deliver(message, pigeon::thread_safe([&calls, count](int value) { ++calls; return count * value; }));
+
+  SECTION("results in delivery order")
+  {
+    std::vector<int> results;
+    pigeon::parallel_response(pool, message, [&results](int result) { results.push_back(result); }, 10);
+    CHECK(results == std::vector<int>{50, 40, 30, 20, 10});
+    CHECK(calls == 5);
+  }
+
+  SECTION("finish")
+  {
+    std::vector<int> results;
+    pigeon::parallel_response(pool, message, [&results](int result) 
+      { 
+        results.push_back(result);
+        return result == 3 ? pigeon::iteration_state::finish : pigeon::iteration_state::progress;
+      }, 1);
+    CHECK(results == std::vector<int>{5, 4, 3});
+    CHECK(calls == 5);
+  }
+
+  SECTION("repeat")
+  {
+    std::vector<int> results;
+    bool repeated{false};
+    pigeon::parallel_response(pool, message, [&results, &repeated](int result) 
+      { 
+        results.push_back(result);
+        if (result == 3 and not repeated)
+        {
+          repeated = true;
+          return pigeon::iteration_state::repeat;
+        }
+        return pigeon::iteration_state::progress;
+      }, 1);
+    CHECK(results == std::vector<int>{5, 4, 3, 2, 1, 5, 4});
+    CHECK(calls == 9);
+  }
+}
+
+TEST_CASE("parallel_send - dropped while sending")
+{
+  pigeon::thread_pool pool{2};
+  pigeon::pigeon pigeon;
+  pigeon::message<int()> message;
+
+  pigeon::contact_token token;
+  token = pigeon.deliver(message, pigeon::thread_safe([] { return 1; }));
+  pigeon.deliver(message, [&pigeon, &token, &message] 
+    { 
+      CHECK(message.isSending());
+      pigeon.drop(token); 
+      return 2; 
+    });
+
+  std::vector<int> results;
+  pigeon::parallel_response(pool, message, [&results](int result) { results.push_back(result); });
+  CHECK(results == std::vector<int>{2});
+  CHECK(message.size() == 1);
+  CHECK(pigeon.size()  == 1);
+  CHECK_FALSE(message.isSending());
+}
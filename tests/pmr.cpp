@@ -0,0 +1,48 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/pmr.h"
+#include <cstdint>
+#include <vector>
+
+TEST_CASE("pmr - inboxes in a memory resource")
+{
+  std::pmr::monotonic_buffer_resource request;
+  pigeon::memory_resource_allocator alloc{&request};
+  CHECK(alloc.resource() == &request);
+
+  pigeon::message<void(int)> message;
+  int sum{0};
+  {
+    pigeon::pigeon pigeon;
+    for (int count = 0; count < 10; ++count)
+      pigeon.deliver(message).withAllocator(&alloc).to([&sum](int value) { sum += value; });
+    CHECK(alloc.used() > 0);
+
+    message.send(1);
+    CHECK(sum == 10);
+  }
+  CHECK(alloc.used() == 0);
+  CHECK(message.size() == 0);
+
+  request.release();  // all at once, after the contacts are gone
+}
+
+TEST_CASE("pmr - memory resource view of an arena")
+{
+  pigeon::arena_chunk_allocator<256> arena;
+  pigeon::allocator_resource resource{arena};
+  CHECK(&resource.get_allocator() == &arena);
+
+  std::pmr::vector<std::uint64_t> values{&resource};
+  for (std::uint64_t value = 0; value < 100; ++value)
+    values.push_back(value);
+
+  CHECK(values[99] == 99);
+  CHECK(arena.used() >= 100 * sizeof(std::uint64_t));
+
+  pigeon::allocator_resource same{arena};
+  pigeon::pool_allocator<> pool;
+  pigeon::allocator_resource other{pool};
+  CHECK(resource.is_equal(same));
+  CHECK_FALSE(resource.is_equal(other));
+  CHECK_FALSE(resource.is_equal(*std::pmr::new_delete_resource()));
+}
@@ -0,0 +1,445 @@
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/catch_template_test_macros.hpp>
+#include "pigeon/pigeon.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+TEMPLATE_TEST_CASE("storage - deliver, drop and clear", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(), pigeon::global_access, TestType> message;
+  CHECK(message.size() == 0);
+
+  std::vector<int> calls;
+  auto token1 = pigeon.deliver(message, [&calls] { calls.push_back(1); });
+  auto token2 = pigeon.deliver(message, [&calls] { calls.push_back(2); });
+  auto token3 = pigeon.deliver(message, [&calls] { calls.push_back(3); });
+  CHECK(message.size() == 3);
+
+  SECTION("reverse delivery order")
+  {
+    message.send();
+    CHECK(calls == std::vector<int>{3, 2, 1});
+  }
+
+  SECTION("pigeon::drop")
+  {
+    pigeon.drop(token2);
+    CHECK(message.size() == 2);
+    message.send();
+    CHECK(calls == std::vector<int>{3, 1});
+    CHECK(message.size() == 2);
+  }
+
+  SECTION("message::drop")
+  {
+    CHECK(message.drop(token3));
+    CHECK_FALSE(message.drop(token3));
+    CHECK(message.size() == 2);
+    message.send();
+    CHECK(calls == std::vector<int>{2, 1});
+  }
+
+  SECTION("pigeon::clear")
+  {
+    pigeon.clear();
+    CHECK(message.size() == 0);
+    message.send();
+    CHECK(calls.empty());
+  }
+
+  SECTION("message::clear")
+  {
+    message.clear();
+    CHECK(message.size() == 0);
+    message.send();
+    CHECK(calls.empty());
+    CHECK(pigeon.size() == 0);
+  }
+
+  SECTION("many senders")
+  {
+    for (int count = 4; count <= 100; ++count)
+      pigeon.deliver(message, [&calls, count] { calls.push_back(count); });
+
+    message.send();
+    REQUIRE(calls.size() == 100);
+    for (int index = 0; index < 100; ++index)
+      CHECK(calls[index] == 100 - index);
+  }
+
+  (void)token1;
+}
+
+TEMPLATE_TEST_CASE("storage - iteration_state", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<int(), pigeon::global_access, TestType> message;
+
+  std::vector<int> calls;
+  for (int count = 1; count <= 5; ++count)
+    pigeon.deliver(message, [&calls, count] { calls.push_back(count); return count; });
+
+  SECTION("finish")
+  {
+    message.response([](int value) 
+      { return value == 3 ? pigeon::iteration_state::finish : pigeon::iteration_state::progress; });
+    CHECK(calls == std::vector<int>{5, 4, 3});
+  }
+
+  SECTION("repeat")
+  {
+    bool repeated{false};
+    message.response([&repeated](int value) 
+      { 
+        if (value == 3 and not repeated)
+        {
+          repeated = true;
+          return pigeon::iteration_state::repeat; 
+        }
+        return pigeon::iteration_state::progress; 
+      });
+    CHECK(calls == std::vector<int>{5, 4, 3, 2, 1, 5, 4});
+
+    calls.clear();
+    message.send();
+    CHECK(calls == std::vector<int>{3, 2, 1, 5, 4});
+  }
+
+  SECTION("dead senders during iteration")
+  {
+    pigeon::pigeon other;
+    auto token = other.deliver(message, [&calls] { calls.push_back(0); return 0; });
+    other.drop(token);
+    CHECK(message.size() == 5);
+
+    message.send();
+    CHECK(calls == std::vector<int>{5, 4, 3, 2, 1});
+    CHECK(message.size() == 5);
+  }
+}
+
+TEST_CASE("storage - array_storage reentrant deliver from onDrop")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(), pigeon::global_access, pigeon::array_storage> message;
+
+  std::size_t CallCounter{0};
+  pigeon.deliver(message)
+    .onDrop([&pigeon, &message, &CallCounter] (pigeon::contact_token, pigeon::who)
+      { pigeon.deliver(message, [&CallCounter] { ++CallCounter; }); })
+    .to([]{});
+
+  message.clear();
+  CHECK(message.size() == 1);
+  message.send();
+  CHECK(CallCounter == 1);
+}
+
+TEMPLATE_TEST_CASE("storage - drop while sending", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(), pigeon::global_access, TestType> message;
+
+  std::vector<int> calls;
+  pigeon::contact_token token;
+  pigeon.deliver(message, [&calls] { calls.push_back(1); });
+  token = pigeon.deliver(message, [&calls, &pigeon, &token] { calls.push_back(2); pigeon.drop(token); });
+  pigeon.deliver(message, [&calls] { calls.push_back(3); });
+
+  message.send();
+  CHECK(calls == std::vector<int>{3, 2, 1});
+  CHECK(message.size() == 2);
+  CHECK(pigeon.size()  == 2);
+
+  calls.clear();
+  message.send();
+  CHECK(calls == std::vector<int>{3, 1});
+  CHECK(message.size() == 2);
+}
+
+TEMPLATE_TEST_CASE("storage - churn without sending", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(), pigeon::global_access, TestType> message;
+
+  std::size_t CallCounter{0};
+  pigeon.deliver(message, [&CallCounter] { ++CallCounter; });
+  for (int count = 0; count < 10000; ++count)
+  {
+    auto token = pigeon.deliver(message, [&CallCounter] { ++CallCounter; });
+    if (count % 2)
+      pigeon.drop(token);
+    else
+      message.drop(token);
+  }
+
+  CHECK(message.size() == 1);
+  CHECK(pigeon.size()  == 1);
+  message.send();
+  CHECK(CallCounter == 1);
+}
+
+TEMPLATE_TEST_CASE("storage - size and has_subscribers", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<pigeon::iteration_state(), pigeon::global_access, TestType> message;
+  CHECK_FALSE(message.has_subscribers());
+  CHECK_FALSE(pigeon.has_subscribers());
+
+  pigeon::contact_token first, last;
+  first = pigeon.deliver(message, [] { return pigeon::iteration_state::progress; });
+  pigeon.deliver(message, [] { return pigeon::iteration_state::dead; });
+  last = pigeon.deliver(message, [&pigeon, &first, &last]
+    {
+      pigeon.drop(first);  // not yet visited
+      pigeon.drop(last);   // visited, reaped after sending
+      return pigeon::iteration_state::progress;
+    });
+  CHECK(message.size() == 3);
+  CHECK(pigeon.size()  == 3);
+  CHECK(message.has_subscribers());
+
+  message.response([](pigeon::iteration_state state) { return state; });
+  CHECK(message.size() == 0);
+  CHECK(pigeon.size()  == 0);
+  CHECK_FALSE(message.has_subscribers());
+  CHECK_FALSE(pigeon.has_subscribers());
+
+  pigeon.deliver(message, [] { return pigeon::iteration_state::progress; });
+  pigeon.deliver(message, [] { return pigeon::iteration_state::progress; });
+  CHECK(message.size() == 2);
+  message.clear();
+  CHECK(message.size() == 0);
+  CHECK(pigeon.size()  == 0);
+}
+
+TEMPLATE_TEST_CASE("storage - many repeats", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<int(), pigeon::global_access, TestType> message;
+
+  std::vector<int> calls;
+  std::vector<int> order;  // expected delivery order
+  std::vector<pigeon::contact_token> tokens;
+  for (int count = 0; count < 20; ++count)
+  {
+    tokens.push_back(pigeon.deliver(message, [&calls, count] { calls.push_back(count); return count; }));
+    order.insert(order.begin(), count);
+  }
+
+  for (int round = 0; round < 3; ++round)
+  {
+    auto repeats = [round](int value) { return value % 3 == round; };
+
+    // reference: a repeating sender becomes the first one, the others follow in order
+    std::vector<int> expected;
+    std::vector<bool> repeated(order.size(), false);
+    for (size_t index = 0; index < order.size(); ++index)
+    {
+      auto value = order[index];
+      expected.push_back(value);
+      if (repeats(value) and not repeated[value])
+      {
+        repeated[value] = true;
+        std::rotate(order.begin(), order.begin() + index, order.end());
+        index = 0;
+      }
+    }
+
+    calls.clear();
+    std::vector<bool> done(order.size(), false);
+    message.response([&repeats, &done](int value)
+      {
+        if (repeats(value) and not done[value])
+        {
+          done[value] = true;
+          return pigeon::iteration_state::repeat;
+        }
+        return pigeon::iteration_state::progress;
+      });
+    CHECK(calls == expected);
+  }
+
+  calls.clear();
+  message.send();
+  CHECK(calls == order);
+
+  for (int value: {4, 11, 17})
+  {
+    pigeon.drop(tokens[value]);
+    order.erase(std::find(order.begin(), order.end(), value));
+  }
+
+  for (int round = 0; round < 2; ++round)
+  {
+    calls.clear();
+    message.send();
+    CHECK(calls == order);
+  }
+
+  pigeon.deliver(message, [&calls] { calls.push_back(20); return 20; });
+  order.insert(order.begin(), 20);
+  calls.clear();
+  message.send();
+  CHECK(calls == order);
+}
+
+TEST_CASE("storage - inline_storage")
+{
+  auto& pool = pigeon::detail::slot_pool::local();
+  auto used  = pool.used();
+
+  pigeon::pigeon pigeon;
+  pigeon::message<void(int), pigeon::global_access, pigeon::inline_storage<2>> message;
+
+  int sum{0};
+  auto first = pigeon.deliver(message, [&sum](int value) { sum += value; });
+  pigeon.deliver(message, [&sum](int value) { sum += 10 * value; });
+  CHECK(pool.used() == used);  // both senders live inside the message
+
+  pigeon.deliver(message, [&sum](int value) { sum += 100 * value; });
+  CHECK(pool.used() == used + 1);  // the third one spills
+
+  message.send(1);
+  CHECK(sum == 111);
+
+  pigeon.drop(first);
+  pigeon.deliver(message, [&sum](int value) { sum += 1000 * value; });
+  CHECK(pool.used() == used + 1);  // the dropped sender freed its inline slot
+
+  sum = 0;
+  message.send(1);
+  CHECK(sum == 1110);
+
+  SECTION("too big for a slot")
+  {
+    struct { char Data[pigeon::detail::slot_pool::SlotSize]; } big{};
+    pigeon.drop(pigeon.deliver(message, [big](int) { (void)big; }));
+    CHECK(message.size() == 3);
+  }
+
+  SECTION("allocator_pigeon keeps using its allocator")
+  {
+    pigeon::allocator_pigeon<pigeon::arena_stack_allocator<200>> stackPigeon;
+    pigeon.clear();
+    stackPigeon.deliver(message, [&sum](int value) { sum = value; });
+    CHECK(stackPigeon.used_memory() > 0);
+    message.send(7);
+    CHECK(sum == 7);
+  }
+
+  message.clear();
+  CHECK(pool.used() == used);
+}
+
+TEST_CASE("storage - slots released on another thread")
+{
+  auto& pool = pigeon::detail::slot_pool::local();
+  auto used  = pool.used();
+
+  SECTION("the owning thread takes them back")
+  {
+    pigeon::message<void(int)> message;
+    {
+      pigeon::pigeon pigeon;
+      for (int index = 0; index < 100; ++index)
+        pigeon.deliver(message, [](int) { });
+      CHECK(pool.used() == used + 100);
+
+      std::thread([&pigeon] { pigeon.clear(); }).join();
+      CHECK(pool.used() == used);
+    }
+
+    auto chunks = pool.chunks();
+    pigeon::pigeon pigeon;
+    for (int index = 0; index < 100; ++index)
+      pigeon.deliver(message, [](int) { });
+    CHECK(pool.chunks() == chunks);  // reuses the slots released on the other thread
+  }
+
+  SECTION("the pool outlives its thread")
+  {
+    pigeon::message<void(int)> message;
+    pigeon::pigeon pigeon;
+    std::thread([&] 
+    { 
+      for (int index = 0; index < 10; ++index)
+        pigeon.deliver(message, [](int) { }); 
+    }).join();
+
+    int count{0};
+    pigeon.deliver(message, [&count](int) { ++count; });
+    message.send(1);
+    CHECK(count == 1);
+    pigeon.clear();  // the last release deletes the pool of the ended thread
+  }
+
+  CHECK(pool.used() == used);
+}
+
+TEMPLATE_TEST_CASE("storage - priorities", "[storage]", pigeon::list_storage, pigeon::array_storage, pigeon::inline_storage<2>)
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<int(), pigeon::global_access, TestType> message;
+
+  std::vector<int> calls;
+  auto deliver = [&](int value, std::int16_t priority)
+    { 
+      return pigeon.deliver(message).withPriority(priority)
+        .to([&calls, value] { calls.push_back(value); return value; });
+    };
+
+  deliver(1, 0);
+  deliver(2, 5);
+  deliver(3, -1);
+  deliver(4, 5);
+  deliver(5, 0);
+
+  SECTION("higher priorities first, equal priorities in reverse order")
+  {
+    message.send();
+    CHECK(calls == std::vector<int>{4, 2, 5, 1, 3});
+  }
+
+  SECTION("finish skips the lower priorities")
+  {
+    message.response([](int value) 
+      { return value == 2 ? pigeon::iteration_state::finish : pigeon::iteration_state::progress; });
+    CHECK(calls == std::vector<int>{4, 2});
+  }
+
+  SECTION("repeat keeps the priority order")
+  {
+    bool repeated{false};
+    message.response([&repeated](int value) 
+      { 
+        if (value == 1 and not repeated)
+        {
+          repeated = true;
+          return pigeon::iteration_state::repeat; 
+        }
+        return pigeon::iteration_state::progress; 
+      });
+    CHECK(calls == std::vector<int>{4, 2, 5, 1, 3, 4, 2, 5});
+
+    calls.clear();
+    message.send();
+    CHECK(calls == std::vector<int>{4, 2, 5, 1, 3});
+
+    deliver(6, 1);
+    calls.clear();
+    message.send();
+    CHECK(calls == std::vector<int>{4, 2, 6, 5, 1, 3});
+  }
+
+  SECTION("drop keeps the priority order")
+  {
+    auto token = deliver(6, 5);
+    deliver(7, -1);
+    pigeon.drop(token);
+    message.send();
+    CHECK(calls == std::vector<int>{4, 2, 5, 1, 7, 3});
+  }
+}
@@ -1,18 +1,20 @@
 #include <catch2/catch_test_macros.hpp>
 #include "pigeon/pigeon.h"
 #include <iostream>
+#include <memory>
+#include <string>
 
 static_assert(sizeof (pigeon::pigeon) == sizeof(void*), "pigeon::pigeon too big");
-static_assert(sizeof (pigeon::message<>) == sizeof(void*), "pigeon::message<> too big");
+static_assert(sizeof (pigeon::message<>) == 3 * sizeof(void*), "pigeon::message<> too big");
 
-static_assert(sizeof (pigeon::detail::contact) == 2 * sizeof(void*), "pigeon::detail::contact too big");
-static_assert(sizeof (pigeon::detail::sender<void>) == 3 * sizeof(void*), "pigeon::detail::sender too big");
+static_assert(sizeof (pigeon::detail::contact) == 4 * sizeof(void*), "pigeon::detail::contact too big");
+static_assert(sizeof (pigeon::detail::sender<void>) == 7 * sizeof(void*), "pigeon::detail::sender too big");
 
 auto handler_dummy = [] { };
 auto drop_dummy = [] { };
-static_assert(sizeof (pigeon::detail::inbox<decltype(handler_dummy), decltype(drop_dummy), void>) == 3 * sizeof(void*), 
+static_assert(sizeof (pigeon::detail::inbox<decltype(handler_dummy), decltype(drop_dummy), void>) == 7 * sizeof(void*), 
   "pigeon::detail::inbox too big");
-static_assert(sizeof (pigeon::detail::inbox_with_allocator<decltype(handler_dummy), decltype(drop_dummy), void>) == 4 * sizeof(void*),
+static_assert(sizeof (pigeon::detail::inbox_with_allocator<decltype(handler_dummy), decltype(drop_dummy), void>) == 8 * sizeof(void*),
   "pigeon::detail::inbox_with_allocator too big");
 
 TEST_CASE("Single Pigeon - Single Message")
@@ -151,13 +153,13 @@ TEST_CASE("pigeon drop first")
     bool CalledAllocate{false};
     bool CalledDeAllocate{false};
 
-    void* allocate(std::size_t size_bytes) override
+    void* allocate(std::size_t size_bytes, std::size_t) override
     { 
       CalledAllocate = true;
       return ::operator new(size_bytes); 
     }
 
-    void deallocate(void* pointer, std::size_t) override 
+    void deallocate(void* pointer, std::size_t, std::size_t) override 
     { 
       CalledDeAllocate = true;
       ::operator delete(pointer);
@@ -186,13 +188,13 @@ TEST_CASE("message drop first")
     bool CalledAllocate{false};
     bool CalledDeAllocate{false};
 
-    void* allocate(std::size_t size_bytes) override
+    void* allocate(std::size_t size_bytes, std::size_t) override
     { 
       CalledAllocate = true;
       return ::operator new(size_bytes); 
     }
 
-    void deallocate(void* pointer, std::size_t) override 
+    void deallocate(void* pointer, std::size_t, std::size_t) override 
     { 
       CalledDeAllocate = true;
       ::operator delete(pointer);
@@ -221,13 +223,13 @@ TEST_CASE("either drop first")
     bool CalledAllocate{false};
     bool CalledDeAllocate{false};
 
-    void* allocate(std::size_t size_bytes) override
+    void* allocate(std::size_t size_bytes, std::size_t) override
     { 
       CalledAllocate = true;
       return ::operator new(size_bytes); 
     }
 
-    void deallocate(void* pointer, std::size_t) override 
+    void deallocate(void* pointer, std::size_t, std::size_t) override 
     { 
       CalledDeAllocate = true;
       ::operator delete(pointer);
@@ -356,7 +358,7 @@ TEST_CASE("allocator")
       std::cout << "~test_allocator called\n";
     }
 */
-    void* allocate(std::size_t size_bytes) override
+    void* allocate(std::size_t size_bytes, std::size_t) override
     { 
 //      std::cout << "allocate called\n";
       ++AllocateCount;
@@ -364,7 +366,7 @@ TEST_CASE("allocator")
       return ::operator new(size_bytes); 
     }
 
-    void deallocate(void* pointer, std::size_t) override 
+    void deallocate(void* pointer, std::size_t, std::size_t) override 
     { 
 //      std::cout << "deallocate called\n";
       ++DeAllocateCount;
@@ -412,14 +414,337 @@ TEST_CASE("value_state")
 
 TEST_CASE("stackmemory")
 {
-  pigeon::allocator_pigeon<pigeon::arena_stack_allocator<100>> pigeon;
-  CHECK(pigeon.available_memory() == 100);
+  pigeon::allocator_pigeon<pigeon::arena_stack_allocator<200>> pigeon;
+  CHECK(pigeon.available_memory() == 200);
 
   pigeon::message<> message1;  
   pigeon.deliver(message1).to([]{});
-  CHECK(pigeon.available_memory() == 60);
+  CHECK(pigeon.available_memory() == 136);
 
   pigeon::message<> message2;  
   pigeon.deliver(message2).to([]{});
-  CHECK(pigeon.available_memory() == 20);
+  CHECK(pigeon.available_memory() == 72);
+}
+
+TEST_CASE("pigeon destroyed by a handler")
+{
+  pigeon::message<> message;
+  pigeon::message<> other;
+  int count{0};
+
+  SECTION("the sending message reaps the contacts later")
+  {
+    auto pigeon = new pigeon::pigeon;
+    pigeon->deliver(message).to([&]{ ++count; delete pigeon; });
+    pigeon->deliver(message).to([&]{ ++count; });
+
+    message.send();
+    auto sent = count;
+    message.send();
+    CHECK(count == sent);
+    CHECK(message.size() == 0);
+  }
+
+  SECTION("allocator_pigeon with contacts of a message not sending")
+  {
+    using stack_pigeon = pigeon::allocator_pigeon<pigeon::arena_stack_allocator<200>>;
+    auto pigeon = new stack_pigeon;
+    pigeon->deliver(other).to([&]{ ++count; });
+
+    pigeon::pigeon killer;
+    killer.deliver(message).to([&]{ delete pigeon; });
+    message.send();
+
+    other.send();
+    CHECK(count == 0);
+    CHECK(other.size() == 0);
+  }
+  // An allocator_pigeon destroyed by a handler of one of its own messages ends in std::terminate,
+  // the message would read the contacts after their memory is gone
+}
+
+TEST_CASE("slot_pool")
+{
+  auto& pool = pigeon::detail::slot_pool::local();
+  auto used  = pool.used();
+
+  pigeon::pigeon pigeon;
+  pigeon::message<void(int)> message;
+
+  int sum{0};
+  auto token = pigeon.deliver(message, [&sum](int value) { sum += value; });
+  CHECK(pool.used() == used + 1);
+
+  message.send(42);
+  CHECK(sum == 42);
+
+  SECTION("released on drop")
+  {
+    pigeon.drop(token);
+    message.clear();
+    CHECK(pool.used() == used);
+  }
+
+  SECTION("slots are reused")
+  {
+    auto chunks = pool.chunks();
+    for (int count = 0; count < 1000; ++count)
+    {
+      auto churn = pigeon.deliver(message, [&sum](int value) { sum -= value; });
+      pigeon.drop(churn);
+      message.send(1);
+    }
+    CHECK(pool.chunks() == chunks);
+    CHECK(sum == 42 + 1000);
+  }
+
+  SECTION("big handlers do not use a slot")
+  {
+    struct { char Data[pigeon::detail::slot_pool::SlotSize]; } big{};
+    pigeon.deliver(message, [big](int) { (void)big; });
+    CHECK(pool.used() == used + 1);
+  }
+}
+
+TEST_CASE("arguments by value")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(std::string)> message;
+
+  std::string const text{"a string too long for the small string optimization"};
+  std::size_t CallCounter{0};
+  for (int count = 0; count < 3; ++count)
+    pigeon.deliver(message, [&text, &CallCounter](std::string value) 
+      { 
+        CHECK(value == text); 
+        ++CallCounter; 
+      }
+    );
+
+  message.send(text);
+  CHECK(CallCounter == 3);
+
+  SECTION("handlers changing or moving their copy")
+  {
+    pigeon.deliver(message, [&text, &CallCounter](std::string&& value) 
+      { 
+        CHECK(value == text); 
+        std::string moved{std::move(value)};
+        ++CallCounter; 
+      }
+    );
+    pigeon.deliver(message, [&text, &CallCounter](std::string value) 
+      { 
+        CHECK(value == text); 
+        value += "!";
+        ++CallCounter; 
+      }
+    );
+
+    CallCounter = 0;
+    message.send(text);
+    CHECK(CallCounter == 5);
+  }
+
+  SECTION("a single handler gets the value itself")
+  {
+    pigeon::message<void(std::unique_ptr<int>)> single;
+    int result{0};
+    pigeon.deliver(single, [&result](std::unique_ptr<int>&& value) { result = *value; });
+    single.send(std::unique_ptr<int>{new int{42}});
+    CHECK(result == 42);
+  }
+}
+
+TEST_CASE("drop reclaims at once")
+{
+  struct: pigeon::allocator
+  {
+    std::size_t Live{0};
+
+    void* allocate(std::size_t size_bytes, std::size_t) override
+    { 
+      ++Live;
+      return ::operator new(size_bytes); 
+    }
+
+    void deallocate(void* pointer, std::size_t, std::size_t) override 
+    { 
+      --Live;
+      ::operator delete(pointer);
+    }
+  } allocator;
+
+  pigeon::pigeon pigeon;
+  pigeon::message<> message;
+
+  auto token = pigeon.deliver(message, []{}, &allocator);
+  CHECK(allocator.Live == 1);
+
+  SECTION("pigeon first")
+  {
+    CHECK(pigeon.drop(token));
+    CHECK(allocator.Live == 0);
+    CHECK(message.size() == 0);
+    CHECK_FALSE(pigeon.drop(token));
+    CHECK_FALSE(message.drop(token));
+  }
+
+  SECTION("message first")
+  {
+    CHECK(message.drop(token));
+    CHECK(allocator.Live == 0);
+    CHECK(pigeon.size() == 0);
+    CHECK_FALSE(pigeon.drop(token));
+  }
+
+  SECTION("message destructed first")
+  {
+    {
+      pigeon::message<> shortlived;
+      pigeon.deliver(shortlived, []{}, &allocator);
+      CHECK(allocator.Live == 2);
+      CHECK(pigeon.size() == 2);
+    }
+    CHECK(allocator.Live == 1);
+    CHECK(pigeon.size() == 1);
+  }
+
+  SECTION("pigeon destructed first")
+  {
+    {
+      pigeon::pigeon shortlived;
+      shortlived.deliver(message, []{}, &allocator);
+      CHECK(allocator.Live == 2);
+      CHECK(message.size() == 2);
+    }
+    CHECK(allocator.Live == 1);
+    CHECK(message.size() == 1);
+  }
+}
+
+TEST_CASE("contact_token")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<> message;
+
+  std::size_t CallCounter{0};
+  auto first = pigeon.deliver(message, [&CallCounter] { ++CallCounter; });
+  pigeon.drop(first);
+
+  SECTION("stale token after reuse")
+  {
+    auto second = pigeon.deliver(message, [&CallCounter] { ++CallCounter; });
+    CHECK_FALSE(pigeon.drop(first));
+    CHECK_FALSE(message.drop(first));
+    message.send();
+    CHECK(CallCounter == 1);
+    CHECK(message.drop(second));
+  }
+
+  SECTION("token of another pigeon")
+  {
+    pigeon::pigeon other;
+    auto token = other.deliver(message, [&CallCounter] { ++CallCounter; });
+    CHECK_FALSE(pigeon.drop(token));
+    message.send();
+    CHECK(CallCounter == 1);
+  }
+
+  SECTION("token of another message")
+  {
+    pigeon::message<> other;
+    auto token = pigeon.deliver(other, [&CallCounter] { ++CallCounter; });
+    CHECK_FALSE(message.drop(token));
+    CHECK(other.drop(token));
+  }
+
+  SECTION("default constructed")
+  {
+    pigeon::contact_token token;
+    CHECK_FALSE(pigeon.drop(token));
+    CHECK_FALSE(message.drop(token));
+  }
+
+  SECTION("token of a destroyed pigeon")
+  {
+    pigeon::contact_token token;
+    {
+      pigeon::pigeon shortlived;
+      token = shortlived.deliver(message, [&CallCounter] { ++CallCounter; });
+    }
+    CHECK_FALSE(message.drop(token));
+    CHECK_FALSE(pigeon.drop(token));
+  }
+
+  SECTION("token of a destroyed pigeon whose table is reused")
+  {
+    pigeon::message<> other;
+    pigeon::contact_token token;
+    {
+      pigeon::pigeon shortlived;
+      token = shortlived.deliver(other, [&CallCounter] { ++CallCounter; });
+    }
+
+    // the next pigeon gets the table of the destroyed one, same address, index and generation
+    pigeon::pigeon successor;
+    auto fresh = successor.deliver(other, [&CallCounter] { ++CallCounter; });
+    CHECK_FALSE(other.drop(token));
+    CHECK_FALSE(successor.drop(token));
+    other.send();
+    CHECK(CallCounter == 1);
+    CHECK(other.drop(fresh));
+  }
+}
+
+TEST_CASE("copy pigeon")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<> message;
+  pigeon.deliver(message, []{});
+
+  pigeon::pigeon copy{pigeon};
+  CHECK(copy.size() == 0);
+  CHECK(pigeon.size() == 1);
+}
+
+TEST_CASE("send_batch")
+{
+  pigeon::pigeon pigeon;
+  pigeon::message<void(std::string)> message;
+
+  std::vector<std::string> calls;
+  pigeon.deliver(message, [&calls](std::string const& event) { calls.push_back("one " + event); });
+  pigeon.deliver(message, [&calls](std::string event) { event += "!"; calls.push_back("copy " + event); });
+  pigeon.deliver(message, pigeon::batch([&calls](pigeon::batch_view<std::string> events) 
+    { 
+      calls.push_back("batch " + std::to_string(events.size())); 
+    }));
+
+  std::vector<std::string> events{"a", "b"};
+  message.send_batch(events);
+  CHECK(calls == std::vector<std::string>{"batch 2", "copy a!", "copy b!", "one a", "one b"});
+  CHECK(events == std::vector<std::string>{"a", "b"});
+
+  calls.clear();
+  message.send("c");
+  CHECK(calls == std::vector<std::string>{"batch 1", "copy c!", "one c"});
+
+  calls.clear();
+  message.send_batch({events.data(), 0});
+  CHECK(calls.empty());
+
+  SECTION("drop during the batch")
+  {
+    pigeon::message<void(int)> numbers;
+    int sum{0};
+    pigeon::contact_token token;
+    token = pigeon.deliver(numbers, [&sum](int value) { sum += value; });
+    pigeon.deliver(numbers, [&pigeon, &token](int) { pigeon.drop(token); });
+
+    int values[] = {1, 2, 3};
+    numbers.send_batch({values, 3});
+    CHECK(sum == 0);
+    CHECK(numbers.size() == 1);
+  }
 }
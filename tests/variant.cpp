@@ -0,0 +1,93 @@
+#include <catch2/catch_test_macros.hpp>
+#include "pigeon/variant.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+  struct Small { int Value; };
+  struct Large { std::vector<int> Values; };
+  using Payload = std::variant<Small, Large, std::string>;
+}
+
+TEST_CASE("variant_message - send by alternative")
+{
+  pigeon::pigeon pigeon;
+  pigeon::variant_message<Payload> message;
+  CHECK_FALSE(message.has_subscribers());
+
+  std::vector<std::string> calls;
+  pigeon.deliver(message.alternative<Small>(), [&calls](Small const& small) { calls.push_back("small " + std::to_string(small.Value)); });
+  pigeon.deliver(message.alternative<Small>(), [&calls](Small const&) { calls.push_back("small"); });
+  auto token = pigeon.deliver(message.alternative<std::string>(), [&calls](std::string const& text) { calls.push_back(text); });
+  CHECK(message.size() == 3);
+  CHECK(message.has_subscribers());
+
+  message.send(Small{7});
+  message.send(Large{{1, 2, 3}});
+  message.send(std::string("text"));
+  CHECK(calls == std::vector<std::string>{"small", "small 7", "text"});
+
+  SECTION("drop")
+  {
+    CHECK(message.drop(token));
+    CHECK_FALSE(message.drop(token));
+    CHECK(message.size() == 2);
+
+    calls.clear();
+    message.send(std::string("text"));
+    CHECK(calls.empty());
+  }
+
+  SECTION("clear")
+  {
+    message.clear();
+    CHECK(message.size() == 0);
+    CHECK(pigeon.size()  == 0);
+  }
+}
+
+TEST_CASE("variant_message - valueless variant")
+{
+  struct Throwing 
+  { 
+    Throwing() = default;
+    Throwing(Throwing const&) { throw 1; } 
+  };
+
+  pigeon::pigeon pigeon;
+  pigeon::variant_message<std::variant<Small, Throwing>> message;
+
+  int calls{0};
+  pigeon.deliver(message.alternative<Small>(), [&calls](Small const&) { ++calls; });
+  pigeon.deliver(message.alternative<Throwing>(), [&calls](Throwing const&) { ++calls; });
+
+  std::variant<Small, Throwing> value{Small{1}};
+  Throwing throwing;
+  CHECK_THROWS(value = throwing);
+  REQUIRE(value.valueless_by_exception());
+
+  message.send(value);
+  CHECK(calls == 0);
+}
+
+namespace
+{
+  struct Owner
+  {
+    pigeon::variant_message<Payload, Owner> Message;
+    void send(Payload const& payload) { Message.send(payload); }
+  };
+}
+
+TEST_CASE("variant_message - friend access")
+{
+  pigeon::pigeon pigeon;
+  Owner owner;
+
+  int sum{0};
+  pigeon.deliver(owner.Message.alternative<Small>(), [&sum](Small const& small) { sum += small.Value; });
+  owner.send(Small{3});
+  owner.send(Large{});
+  CHECK(sum == 3);
+}